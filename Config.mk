@@ -0,0 +1,30 @@
+name		:= tiedit
+
+################ Programs ############################################
+
+CC		:= gcc
+INSTALL		:= install
+INSTALL_PROGRAM	:= ${INSTALL} -m 755 -s
+
+################ Destination #########################################
+
+prefix		:= /usr/local
+bindir		:= ${prefix}/bin
+TMPDIR		:= /tmp
+builddir	:= ${TMPDIR}/make/${name}
+O		:= .o/
+
+################ Compiler options ####################################
+
+#debug		:= 1
+libs		:= -lncurses -ltinfo
+ifdef debug
+    cflags	:= -O0 -ggdb3
+    ldflags	:= -g -rdynamic
+else
+    cxxflags	:= -Os -g0 -DNDEBUG=1
+    ldflags	:= -s
+endif
+CFLAGS		:= -Wall -Wextra -Wredundant-decls -Wshadow
+cflags		+= -std=c11 -pthread -D_DEFAULT_SOURCE -D_XOPEN_SOURCE=600 ${CFLAGS}
+ldflags		+= -pthread  ${LDFLAGS}
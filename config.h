@@ -0,0 +1,31 @@
+// This file is part of the tiedit project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+//
+// config.h generated by configure
+#pragma once
+
+// Define to the one symbol short name of this package.
+#define TIEDIT_NAME		"tiedit"
+// Define to the version of this package.
+#define TIEDIT_VERSION		0x
+// Define to the version string of this package.
+#define TIEDIT_VERSTRING	"7e7bbe4"
+// Define to the address where bug reports for this package should be sent.
+#define TIEDIT_BUGREPORT	"Mike Sharov <msharov@users.sourceforge.net>"
+
+// Using GNU-specific glibc features
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#if !__has_include(<curses.h>)
+    #error "Curses is required to build this package"
+#endif
+
+#define TERMINFO_DB_PATH	"/usr/share/terminfo"
+
+#define UNUSED	__attribute__((unused))
+#define CONST	__attribute__((const))
+#define PURE	__attribute__((pure))
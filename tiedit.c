@@ -6,6 +6,7 @@
 #include "config.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <curses.h>
 #include <signal.h>
@@ -14,6 +15,24 @@
 #include <string.h>
 #include <limits.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <termios.h>
+#include <stdarg.h>
+#include <poll.h>
+#include <getopt.h>
+#include <malloc.h>
+#if __SSE2__
+    #include <emmintrin.h>
+#endif
 
 //{{{ Prototypes -------------------------------------------------------
 
@@ -23,16 +42,105 @@ enum {
 };
 
 static inline unsigned min (unsigned a, unsigned b) CONST;
+static inline unsigned max (unsigned a, unsigned b) CONST;
 static void* Realloc (void* op, size_t nsz);
-static void ReadBytes (int fd, void* buf, size_t bufsz);
+static void Free (void* p);
+static char* StrDup (const char* s);
+enum ESyscall;
+static void CountSyscall (enum ESyscall s, ssize_t bytesRead);
+static bool ReadBytes (int fd, void* buf, size_t bufsz);
+static ssize_t Pread (int fd, void* buf, size_t bufsz, off_t offset);
+static char* ReadWholeFd (int fd, size_t* psize);
+static char* ReadWholeFile (const char* path, size_t* psize);
+static uint64_t NowNs (void);
+static uint64_t TraceBegin (void);
+static void TraceSpan (const char* name, uint64_t start, size_t bytes);
+static void TraceThread (const char* name);
+static void WriteTrace (void);
+
+struct STerminfo;
+struct SValue;
+static bool LoadTerminfo (const char* tifile, struct STerminfo* ti);
+static bool ValidTerminfo (const struct STerminfo* ti) PURE;
+static const char* TerminfoDbPath (void);
+static void TermFilePath (const char* termname, char* termfile, size_t termfilesz);
+static void FreeTerminfo (struct STerminfo* ti);
+static bool TerminfoBoolean (const struct STerminfo* ti, unsigned i) PURE;
+static int TerminfoNumber (const struct STerminfo* ti, unsigned i) PURE;
+static const char* TerminfoString (const struct STerminfo* ti, unsigned i, unsigned* plen);
+static uint32_t HashName (const char* s) PURE;
+static uint64_t Fingerprint (const void* p, size_t n) PURE;
+static unsigned FindExtValue (const struct STerminfo* ti, const char* name) PURE;
+static unsigned TerminfoRows (const struct STerminfo* ti) PURE;
+static void GetRowValue (const struct STerminfo* ti, unsigned r, struct SValue* v);
+static bool SameValue (const struct SValue* a, const struct SValue* b) PURE;
+static unsigned DiffTerminfo (const struct STerminfo* a, const struct STerminfo* b, uint8_t* changed);
+
+static unsigned FindValueByName (const char* name) PURE;
+static void PrintEscaped (const char* s, unsigned slen);
+static bool QueryValue (const char* tifile, unsigned r);
+static void PrintValue (const struct SValue* v);
+
+static struct STerminfo* AcquireTerminfo (const char* tifile);
+static struct STerminfo* AcquireTerminfoBytes (const void* data, size_t size);
+static void ReleaseTerminfo (struct STerminfo* ti);
+static void ClearEntryCache (void);
+static void PrefetchAroundSelection (int direction);
+static void StopPrefetch (void);
+static void PrintStats (void);
+
+static void PushScannedName (const char* dbpath, const char* path);
+static void PushScanRecord (char* rec);
+static void* ScanThread (void* dbpath);
+static void StartScan (void);
+static void StopScan (void);
+static bool CollectScannedNames (void);
+static bool ScanFinished (void);
+static unsigned BrowserRows (void);
+static unsigned BrowserTerm (unsigned r);
+
+static unsigned FindByte (const char* s, unsigned i, unsigned n, char c) PURE;
+static int FuzzyScore (const char* key, unsigned keysz, const char* q, unsigned qlen) PURE;
+static void FilterTerms (void);
+static void FilterNewTerms (unsigned first);
+
+static unsigned ScreenCols (void) PURE;
+static unsigned ScreenLines (void) PURE;
+static void ScreenMove (unsigned y, unsigned x);
+static void ScreenAttr (unsigned a);
+static void ScreenAddnstr (const char* s, unsigned n);
+static void ScreenAddstr (const char* s);
+static void ScreenAddch (char c);
+static void ScreenPrintf (const char* fmt, ...) __attribute__((format(printf,1,2)));
+static void ScreenErase (void);
+static void ScreenRefresh (void);
+static void ScreenBeep (void);
+static int ScreenKey (void);
+static bool OpenScreen (void);
+static void CloseScreen (void);
 
 static void FillRect (unsigned x, unsigned y, unsigned w, unsigned h);
-static void DrawLine (unsigned l, bool selected);
+static void UpdateLayout (void);
+static void FreeHexView (void);
+static void DrawHex (void);
+static void OnHexKey (unsigned key);
+static unsigned DrawRow (unsigned l, unsigned r, unsigned maxLines);
+static void DrawEntry (void);
+static void DrawBrowser (void);
 static void Draw (void);
+static void OnListKey (unsigned key, unsigned n, unsigned* ptopline, unsigned* pselection);
+static void OnEntryKey (unsigned key);
+static void OnBrowserKey (unsigned key);
 static void OnKey (unsigned key);
 
+static void WatchEntryFile (const char* path);
+static void OnWatchEvent (void);
 static void EventLoop (void);
+enum EStartupPhase;
+static void StartupMark (enum EStartupPhase p);
+static void PrintStartupProfile (void);
 static void InitUI (void);
+static bool InitColors (void);
 static void CleanupUI (void);
 static void OnQuitSignal (int sig);
 static void OnMsgSignal (int sig);
@@ -48,16 +156,20 @@ enum {
     NValues	= FirstString + NStrings
 };
 
-static const char* GetStrtableEntry (unsigned idx, unsigned maxstr, const char* strs, unsigned strssize) PURE;
-static const char* GetBooleanName (unsigned i) PURE;
-static const char* GetNumberName (unsigned i) PURE;
-static const char* GetStringName (unsigned i) PURE;
+static const char* CapPoolString (unsigned o) CONST;
+static const char* ValueName (unsigned r) PURE;
+static const char* ValueShortName (unsigned r) PURE;
+static const char* ValueTermcap (unsigned r) PURE;
+static const char* ValueDescription (unsigned r) PURE;
 
-enum { TERMINFO_MAGIC = 0432 };
+enum {
+    TERMINFO_MAGIC = 0432,
+    TERMINFO_MAGIC_32BIT = 01036	///< ncurses 6.1 format, with 32 bit numbers
+};
 
 /// The header of the terminfo file
 struct STerminfoHeader {
-    uint16_t	magic;		///< Equal to TERMINFO_MAGIC constant above.
+    uint16_t	magic;		///< TERMINFO_MAGIC or TERMINFO_MAGIC_32BIT above.
     uint16_t	nameSize;
     uint16_t	nBooleans;
     uint16_t	nNumbers;
@@ -65,26 +177,193 @@ struct STerminfoHeader {
     uint16_t	strtableSize;
 };
 
+/// File offsets of the sections following the header
+struct STerminfoLayout {
+    off_t	name;
+    off_t	booleans;
+    off_t	numbers;	///< Aligned to 2, after a pad byte if needed
+    off_t	strings;
+    off_t	strtable;
+    off_t	end;
+    unsigned	numberSize;	///< 2, or 4 for TERMINFO_MAGIC_32BIT
+};
+
+/// The header of the extended section with user-defined capabilities.
+/// It follows the strtable, aligned to 2, in entries written by ncurses.
+struct STerminfoExtHeader {
+    uint16_t	nBooleans;
+    uint16_t	nNumbers;
+    uint16_t	nStrings;
+    uint16_t	nStrtableItems;	///< Value strings and names in the strtable
+    uint16_t	strtableSize;
+};
+
+enum { MaxExtValues = 4096 };
+
 struct STerminfo {
     struct STerminfoHeader h;
     char*		name;
     bool*		abool;
-    int16_t*		anum;
+    int32_t*		anum;		///< Widened from 16 bits for TERMINFO_MAGIC files
     uint16_t*		astro;
     char*		strings;
+    struct STerminfoExtHeader xh;
+    bool*		xbool;
+    int32_t*		xnum;
+    uint16_t*		xstro;		///< Value offsets in xstrings
+    uint16_t*		xname;		///< Name offsets in xstrings, for booleans, numbers, then strings
+    char*		xstrings;
+    uint16_t*		xhash;		///< Extended value index+1 by name hash, 0 if empty
+    unsigned		xhashSize;	///< A power of 2
+};
+
+enum EValueType {
+    type_Boolean,
+    type_Number,
+    type_String
 };
 
-static const char c_BooleanNames[];
-static const char c_NumberNames[];
-static const char c_StringNames[];
+/// A value row of an entry, standard or extended
+struct SValue {
+    const char*		name;
+    enum EValueType	type;
+    int32_t		number;		///< Or 1 for a set boolean
+    const char*		string;		///< NULL if absent
+    unsigned		slen;
+};
 
 //}}}-------------------------------------------------------------------
 //{{{ Globals
 
-static struct STerminfo _info = {{0,0,0,0,0,0},NULL,NULL,NULL,NULL,NULL};
+static struct STerminfo* _info = NULL;
+static char _infoPath [PATH_MAX] = "";	///< Of the file _info was loaded from
+static uint8_t* _infoBytes = NULL;	///< Of _info when it has no file, for the hex view
+static size_t _infoBytesSize = 0;
 static bool _quitting = false;
+static bool _showStats = false;
+
+enum EStartupPhase {
+    startup_Loaded,	///< The entry is loaded, or the scan started
+    startup_UI,		///< The terminal is set up
+    startup_FirstFrame,	///< First refresh, before colors are set up
+    startup_ColorFrame,	///< Refresh with colors
+    NStartupPhases
+};
+/// Times from main to each startup phase, printed with --startup-profile
+static struct {
+    uint64_t	start;
+    uint64_t	t [NStartupPhases];
+    bool	enabled;
+} _startup;
 static unsigned _topline = 0;
 static unsigned _selection = 0;
+static unsigned _hscroll = 0;	///< Value columns scrolled off to the left
+static bool _wrap = false;	///< Long values continue on the following lines
+
+enum ESortOrder {
+    sort_Section,	///< As in the file: booleans, numbers, strings, then extended
+    sort_Name,
+    sort_ShortName,	///< By capname; extended values only have the one name
+    sort_Length,	///< Longest values first
+    sort_Defined,	///< Defined values first
+    NSortOrders
+};
+static enum ESortOrder _sortOrder = sort_Section;
+/// The open entry's rows in _sortOrder. _topline and _selection are
+/// positions in it, so it is computed once per entry and order, and
+/// navigation and drawing only index it.
+static struct SSortedRows {
+    const struct STerminfo* ti;
+    enum ESortOrder	order;
+    unsigned		n;
+    uint32_t*		row;	///< Row at each position
+} _sorted;
+
+enum {
+    NAME_COLUMNS = 26,
+    VALUE_COLUMN = 1+NAME_COLUMNS+2,	///< After the name and ": "
+    PREVALENCE_COLUMNS = 12		///< Entries defining the value and sharing it, right-aligned
+};
+/// Display widths and wrap points of the values of the open entry,
+/// computed once per entry and screen width, so that scrolling and
+/// wrapping cost only as much as the visible rows.
+static struct SLayout {
+    const struct STerminfo* ti;
+    unsigned	cols;
+    unsigned	n;		///< Rows
+    unsigned	maxWidth;
+    uint32_t*	width;		///< Escaped width of each row's value
+    uint32_t*	firstBreak;	///< Into breaks, for each row and one past the last
+    uint32_t*	breaks;		///< Value byte offsets where continuation lines start
+    unsigned	nBreaks;
+    unsigned	breaksCapacity;
+} _layout;
+
+enum EView {
+    view_Entry,
+    view_Browser,
+    view_Hex
+};
+static enum EView _view = view_Entry;
+static bool _browsing = false;	///< The browser was started, the entry view returns to it
+
+/// Terminal names streamed in from the database scanner thread
+struct STermList {
+    char**	name;		///< Path relative to the database root, like "x/xterm", NUL, and the entry's names
+    uint32_t*	keyOffset;	///< Start of the fuzzy search key in keys
+    uint16_t*	keySize;
+    uint64_t*	keyChars;	///< Bit c%64 is set for each byte c in the key
+    char*	keys;		///< Packed lowercased names and aliases, padded for vector loads
+    unsigned	keysSize;
+    unsigned	keysCapacity;
+    unsigned	n;
+    unsigned	capacity;
+    unsigned	topline;
+    unsigned	selection;
+};
+static struct STermList _terms = {NULL,NULL,NULL,NULL,NULL,0,0,0,0,0,0};
+
+struct SMatch {
+    int		score;
+    unsigned	term;
+};
+/// Fuzzy filter over _terms, active when the query is not empty
+struct SFilter {
+    char	query [64];
+    unsigned	qlen;
+    bool	editing;	///< Keys go to the query
+    struct SMatch* match;	///< Best match first
+    unsigned	n;
+    unsigned	capacity;
+};
+static struct SFilter _filter = {"",0,false,NULL,0,0};
+
+enum {
+    NAME_RING_SIZE	= 256,	///< Must be a power of 2
+    SCAN_POLL_MS	= 40	///< Browser redraw interval while the scan is running
+};
+/// Lock-free single-producer single-consumer queue from the scanner to the UI
+struct SNameRing {
+    atomic_uint	head;		///< Advanced only by the scanner
+    atomic_uint	tail;		///< Advanced only by the UI thread
+    atomic_bool	done;		///< Set by the scanner after the last push
+    atomic_bool	stop;		///< Set by the UI thread to end the scan early
+    bool	started;
+    pthread_t	tid;
+    char*	slot [NAME_RING_SIZE];
+};
+static struct SNameRing _scanRing;
+
+/// Watch on the directory of the open entry, for reloading it when it changes
+static struct SEntryWatch {
+    int		fd;
+    int		wd;
+    char	path [PATH_MAX];	///< Of the open entry
+    const char*	basename;		///< In path
+    uint8_t*	changed;		///< Rows changed by the last reload
+    unsigned	changedRows;
+} _watch = {-1,-1,"",NULL,NULL,0};
+
 enum EUIColor {
     color_Name,
     color_Value,
@@ -94,6 +373,15 @@ enum EUIColor {
     color_SelectedValue,
     color_SelectedValueSpecial,
     color_StatusLine,
+    color_Changed,
+    color_HexHeader,	///< Colors of the sections in the hex view, in file order
+    color_HexNames,
+    color_HexBooleans,
+    color_HexPad,
+    color_HexNumbers,
+    color_HexOffsets,
+    color_HexStrtable,
+    color_HexExtended,
     NColors
 };
 static const unsigned c_Pairs[NColors][2] = {
@@ -104,9 +392,153 @@ static const unsigned c_Pairs[NColors][2] = {
     { COLOR_CYAN,		COLOR_DEFAULT },
     { COLOR_CYAN,		COLOR_DEFAULT },
     { COLOR_CYAN,		COLOR_DEFAULT },
-    { COLOR_DEFAULT,		COLOR_BLACK }
+    { COLOR_DEFAULT,		COLOR_BLACK },
+    { COLOR_YELLOW,		COLOR_DEFAULT },
+    { COLOR_MAGENTA,		COLOR_DEFAULT },
+    { COLOR_GREEN,		COLOR_DEFAULT },
+    { COLOR_YELLOW,		COLOR_DEFAULT },
+    { COLOR_DEFAULT,		COLOR_RED },
+    { COLOR_CYAN,		COLOR_DEFAULT },
+    { COLOR_BLUE,		COLOR_DEFAULT },
+    { COLOR_DEFAULT,		COLOR_DEFAULT },
+    { COLOR_RED,		COLOR_DEFAULT }
+};
+static unsigned _color[NColors] = { A_NORMAL, A_NORMAL, A_BOLD, A_REVERSE, A_REVERSE, A_REVERSE, A_BOLD| A_REVERSE, A_REVERSE, A_BOLD,
+				    A_BOLD, A_NORMAL, A_BOLD, A_NORMAL, A_BOLD, A_NORMAL, A_NORMAL, A_BOLD };
+
+enum EHexSection {
+    hex_Header,
+    hex_Names,
+    hex_Booleans,
+    hex_Pad,
+    hex_Numbers,
+    hex_Offsets,
+    hex_Strtable,
+    hex_Extended,
+    NHexSections
+};
+enum { HEX_LINE_BYTES = 16 };
+/// The raw entry file, mapped while shown as a hex dump
+static struct SHexView {
+    uint8_t*		p;
+    size_t		size;
+    size_t		sectionEnd [NHexSections];	///< Sections are contiguous, in file order
+    size_t		markStart [2];	///< Bytes of the selected capability,
+    size_t		markEnd [2];	///< its value or offset, and its string
+    unsigned		topline;
+    unsigned		line;
+} _hex;
+
+enum {
+    attr_Bold = 1,
+    attr_Reverse = 2,
+    SCREEN_CAP_SIZE = 32,	///< Longest output or key sequence used by --lite
+    SCREEN_IOV_MAX = 256,	///< Pieces of a frame per writev
+    SCREEN_SKIP_MIN = 8		///< Unchanged cells worth a cursor move to skip
 };
-static unsigned _color[NColors] = { A_NORMAL, A_NORMAL, A_BOLD, A_REVERSE, A_REVERSE, A_REVERSE, A_BOLD| A_REVERSE, A_REVERSE };
+/// Output sequences used by --lite
+enum EScreenCap {
+    scap_Cup,
+    scap_El,
+    scap_Sgr0,
+    scap_Bold,
+    scap_Rev,
+    scap_Clear,
+    scap_Civis,
+    scap_Cnorm,
+    scap_Smcup,
+    scap_Rmcup,
+    scap_Smkx,
+    scap_Rmkx,
+    NScreenCaps
+};
+static const char* const c_ScreenCapNames [NScreenCaps] = {
+    "cursor_address", "clr_eol", "exit_attribute_mode", "enter_bold_mode",
+    "enter_reverse_mode", "clear_screen", "cursor_invisible", "cursor_normal",
+    "enter_ca_mode", "exit_ca_mode", "keypad_xmit", "keypad_local"
+};
+/// Key sequences decoded by --lite into curses key codes
+static const struct { const char* name; int key; } c_ScreenKeys[] = {
+    { "key_up",		KEY_UP },
+    { "key_down",	KEY_DOWN },
+    { "key_left",	KEY_LEFT },
+    { "key_right",	KEY_RIGHT },
+    { "key_ppage",	KEY_PPAGE },
+    { "key_npage",	KEY_NPAGE },
+    { "key_home",	KEY_HOME },
+    { "key_end",	KEY_END },
+    { "key_enter",	KEY_ENTER },
+    { "key_backspace",	KEY_BACKSPACE }
+};
+enum { NScreenKeys = sizeof(c_ScreenKeys)/sizeof(c_ScreenKeys[0]) };
+
+/// The screen drawn without curses, with --lite. Cells are drawn into
+/// chars and attrs, and compared with what the terminal shows on refresh.
+static struct SScreen {
+    bool		lite;
+    bool		active;		///< The terminal is set up for drawing
+    bool		scrollsAtEnd;	///< Writing the last cell may scroll the screen
+    uint8_t		attr;		///< Of the next drawn cells
+    unsigned		cols;
+    unsigned		lines;
+    unsigned		x;
+    unsigned		y;
+    char*		chars;
+    uint8_t*		attrs;
+    char*		shownChars;
+    uint8_t*		shownAttrs;
+    char		cupOut [SCREEN_IOV_MAX][SCREEN_CAP_SIZE];	///< Expanded cursor_address, by iov slot
+    char		cap [NScreenCaps][SCREEN_CAP_SIZE];
+    uint8_t		capLen [NScreenCaps];
+    char		key [NScreenKeys][SCREEN_CAP_SIZE];
+    uint8_t		keyLen [NScreenKeys];
+    char		input [64];
+    unsigned		inputLen;
+    struct termios	savedTermios;
+} _scr;
+
+enum ESyscall {
+    syscall_Open,	///< Directories included
+    syscall_Read,
+    syscall_Close,
+    syscall_Mmap,
+    NSyscalls
+};
+/// I/O and heap use, counted with -s
+static struct {
+    atomic_ulong	calls [NSyscalls];
+    atomic_ulong	bytesRead;
+    atomic_ulong	reallocs;
+    atomic_long		heap;		///< Usable bytes allocated by Realloc and not yet freed
+    atomic_long		peakHeap;
+} _counters;
+
+enum { TRACE_CHUNK_SIZE = 1024 };
+struct STraceEvent {
+    const char*	name;
+    uint64_t	start;		///< ns since _trace.epoch
+    uint64_t	dur;
+    size_t	bytes;		///< Transferred, if not 0
+};
+/// Spans recorded by one thread. Only that thread appends to it, so
+/// recording takes no locks; n is published for the writer at exit.
+struct STraceChunk {
+    struct STraceChunk*	next;	///< In _trace.chunks
+    char		thread [16];
+    unsigned		tid;
+    atomic_uint		n;
+    struct STraceEvent	e [TRACE_CHUNK_SIZE];
+};
+/// Spans written to file at exit as Chrome trace events, with --trace file
+static struct {
+    const char*			file;
+    uint64_t			epoch;
+    _Atomic(struct STraceChunk*) chunks;	///< Lock-free stack of all threads' chunks
+    atomic_uint			nThreads;
+} _trace = {NULL,0,NULL,0};
+static _Thread_local struct STraceChunk* _traceChunk = NULL;
+static _Thread_local char _traceThread [16] = "main";
+static _Thread_local unsigned _traceTid = 0;
 
 //}}}-------------------------------------------------------------------
 //{{{ Utility functions
@@ -116,811 +548,5600 @@ static inline unsigned min (unsigned a, unsigned b)
     return a < b ? a : b;
 }
 
+static inline unsigned max (unsigned a, unsigned b)
+{
+    return a < b ? b : a;
+}
+
+static void CountHeap (long delta)
+{
+    const long heap = atomic_fetch_add_explicit (&_counters.heap, delta, memory_order_relaxed) + delta;
+    long peak = atomic_load_explicit (&_counters.peakHeap, memory_order_relaxed);
+    while (heap > peak && !atomic_compare_exchange_weak (&_counters.peakHeap, &peak, heap)) {}
+}
+
 static void* Realloc (void* op, size_t nsz)
 {
+    const size_t osz = (_showStats && op) ? malloc_usable_size (op) : 0;
     void* p = realloc (op, nsz);
-    if (!p) {
+    if (!p && nsz) {	// realloc to 0 frees op and may return NULL
 	puts ("Error: out of memory");
 	exit (EXIT_FAILURE);
     }
+    if (_showStats) {
+	atomic_fetch_add_explicit (&_counters.reallocs, 1, memory_order_relaxed);
+	CountHeap ((long)(p ? malloc_usable_size (p) : 0) - (long) osz);
+    }
     return p;
 }
 
-static void ReadBytes (int fd, void* buf, size_t bufsz)
+/// Frees memory allocated with Realloc
+static void Free (void* p)
 {
-    if (bufsz != (size_t) read (fd, buf, bufsz)) {
-	perror ("read");
-	exit (EXIT_FAILURE);
-    }
+    if (_showStats && p)
+	CountHeap (-(long) malloc_usable_size (p));
+    free (p);
+}
+
+static char* StrDup (const char* s)
+{
+    const size_t ssz = strlen(s)+1;
+    return (char*) memcpy (Realloc (NULL, ssz), s, ssz);
+}
+
+static void CountSyscall (enum ESyscall s, ssize_t bytesRead)
+{
+    if (!_showStats)
+	return;
+    atomic_fetch_add_explicit (&_counters.calls[s], 1, memory_order_relaxed);
+    if (bytesRead > 0)
+	atomic_fetch_add_explicit (&_counters.bytesRead, bytesRead, memory_order_relaxed);
+}
+
+/// Reads exactly bufsz bytes, a short read fails with errno 0
+static bool ReadBytes (int fd, void* buf, size_t bufsz)
+{
+    const uint64_t t = TraceBegin();
+    ssize_t br = read (fd, buf, bufsz);
+    CountSyscall (syscall_Read, br);
+    TraceSpan ("read", t, bufsz);
+    if (br >= 0)
+	errno = 0;
+    return bufsz == (size_t) br;
+}
+
+/// pread, counted
+static ssize_t Pread (int fd, void* buf, size_t bufsz, off_t offset)
+{
+    const ssize_t br = pread (fd, buf, bufsz, offset);
+    CountSyscall (syscall_Read, br);
+    return br;
+}
+
+/// Reads all of the open file fd into a new buffer, with a NUL appended
+static char* ReadWholeFd (int fd, size_t* psize)
+{
+    struct stat st;
+    char* data = NULL;
+    if (0 == fstat (fd, &st) && st.st_size <= INT32_MAX && 0 == lseek (fd, 0, SEEK_SET)) {
+	data = (char*) Realloc (NULL, st.st_size+1);
+	if (!ReadBytes (fd, data, st.st_size)) {
+	    Free (data);
+	    data = NULL;
+	} else {
+	    data[st.st_size] = 0;
+	    *psize = st.st_size;
+	}
+    } else
+	errno = 0;
+    return data;
+}
+
+/// Reads all of the file at path into a new buffer, with a NUL appended
+static char* ReadWholeFile (const char* path, size_t* psize)
+{
+    int fd = open (path, O_RDONLY);
+    CountSyscall (syscall_Open, 0);
+    if (fd < 0)
+	return NULL;
+    char* data = ReadWholeFd (fd, psize);
+    close (fd);
+    CountSyscall (syscall_Close, 0);
+    return data;
 }
 
 //}}}-------------------------------------------------------------------
-//{{{ Terminfo data loading and editing
+//{{{ Tracing
 
-static void LoadTerminfo (const char* tifile)
+static uint64_t NowNs (void)
 {
-    int fd = open (tifile, O_RDONLY);
-    if (fd < 0) {
-	perror ("open");
-	exit (EXIT_FAILURE);
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+/// Returns the start time for TraceSpan, if tracing
+static uint64_t TraceBegin (void)
+{
+    return _trace.file ? NowNs() : 0;
+}
+
+/// Records a span from start to now in the calling thread's chunk
+static void TraceSpan (const char* name, uint64_t start, size_t bytes)
+{
+    if (!_trace.file)
+	return;
+    const uint64_t end = NowNs();
+    struct STraceChunk* c = _traceChunk;
+    unsigned n = c ? atomic_load_explicit (&c->n, memory_order_relaxed) : TRACE_CHUNK_SIZE;
+    if (n >= TRACE_CHUNK_SIZE) {
+	if (!_traceTid)
+	    _traceTid = atomic_fetch_add (&_trace.nThreads, 1)+1;
+	c = (struct STraceChunk*) Realloc (NULL, sizeof(struct STraceChunk));
+	memcpy (c->thread, _traceThread, sizeof(c->thread));
+	c->tid = _traceTid;
+	atomic_init (&c->n, n = 0);
+	c->next = atomic_load (&_trace.chunks);
+	while (!atomic_compare_exchange_weak (&_trace.chunks, &c->next, c)) {}
+	_traceChunk = c;
     }
-    ReadBytes (fd, &_info.h, sizeof(_info.h));
-    if (_info.h.magic != TERMINFO_MAGIC
-	|| _info.h.nBooleans > NBooleans
-	|| _info.h.nNumbers > NNumbers
-	|| _info.h.nStrings > NStrings) {
-	printf ("Error: %s is not a terminfo file\n", tifile);
-	exit (EXIT_FAILURE);
+    c->e[n].name = name;
+    c->e[n].start = start - _trace.epoch;
+    c->e[n].dur = end - start;
+    c->e[n].bytes = bytes;
+    atomic_store_explicit (&c->n, n+1, memory_order_release);
+}
+
+/// Names the calling thread in the trace
+static void TraceThread (const char* name)
+{
+    snprintf (_traceThread, sizeof(_traceThread), "%s", name);
+}
+
+/// Writes the spans recorded so far. Threads still running may record
+/// more while this runs, which are written if published in time. The
+/// chunks are not freed, for the same reason.
+static void WriteTrace (void)
+{
+    FILE* f = fopen (_trace.file, "w");
+    if (!f) {
+	perror (_trace.file);
+	return;
+    }
+    const int pid = getpid();
+    fputs ("{\"traceEvents\":[\n", f);
+    const char* sep = "";
+    for (const struct STraceChunk* c = atomic_load (&_trace.chunks); c; c = c->next) {
+	fprintf (f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", sep, pid, c->tid, c->thread);
+	sep = ",\n";
+	const unsigned n = atomic_load_explicit (&c->n, memory_order_acquire);
+	for (unsigned i = 0; i < n; ++i) {
+	    const struct STraceEvent* e = &c->e[i];
+	    fprintf (f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+		    e->name, pid, c->tid, e->start/1000.0, e->dur/1000.0);
+	    if (e->bytes)
+		fprintf (f, ",\"args\":{\"bytes\":%zu}", e->bytes);
+	    fputc ('}', f);
+	}
     }
-    _info.name = (char*) Realloc (_info.name, _info.h.nameSize * sizeof(char));
-    _info.abool = (bool*) Realloc (_info.abool, _info.h.nBooleans * sizeof(bool));
-    _info.anum = (int16_t*) Realloc (_info.anum, _info.h.nNumbers * sizeof(int16_t));
-    _info.astro = (uint16_t*) Realloc (_info.astro, _info.h.nStrings * sizeof(uint16_t));
-    _info.strings = (char*) Realloc (_info.strings, _info.h.strtableSize * sizeof(char));
-    ReadBytes (fd, _info.name, _info.h.nameSize * sizeof(char));
-    ReadBytes (fd, _info.abool, _info.h.nBooleans * sizeof(bool));
-    ReadBytes (fd, _info.anum, _info.h.nNumbers * sizeof(int16_t));
-    ReadBytes (fd, _info.astro, _info.h.nStrings * sizeof(uint16_t));
-    ReadBytes (fd, _info.strings, _info.h.strtableSize * sizeof(char));
-    close(fd);
+    fputs ("\n]}\n", f);
+    fclose (f);
 }
 
 //}}}-------------------------------------------------------------------
-//{{{ UI
+//{{{ Terminfo data loading and editing
 
-static void FillRect (unsigned x, unsigned y, unsigned w, unsigned h)
+static void TerminfoLayout (const struct STerminfoHeader* h, struct STerminfoLayout* l)
 {
-    for (unsigned j = 0; j < h; ++j) {
-	move (y+j, x);
-	for (unsigned i = 0; i < w; ++i)
-	    addch (' ');
+    l->numberSize = (h->magic == TERMINFO_MAGIC_32BIT ? sizeof(int32_t) : sizeof(int16_t));
+    l->name = sizeof(*h);
+    l->booleans = l->name + h->nameSize;
+    l->numbers = l->booleans + h->nBooleans;
+    l->numbers += l->numbers % 2;
+    l->strings = l->numbers + h->nNumbers * l->numberSize;
+    l->strtable = l->strings + h->nStrings * sizeof(uint16_t);
+    l->end = l->strtable + h->strtableSize;
+}
+
+static bool IsTerminfoHeader (const struct STerminfoHeader* h)
+{
+    return (h->magic == TERMINFO_MAGIC || h->magic == TERMINFO_MAGIC_32BIT)
+	&& h->nameSize >= 1
+	&& h->nBooleans <= NBooleans
+	&& h->nNumbers <= NNumbers
+	&& h->nStrings <= NStrings;
+}
+
+/// A compiled entry in memory, parsed from front to back
+struct SEntryReader {
+    const char*	p;
+    const char*	end;
+};
+
+/// Copies the next n bytes into buf, failing with errno 0 past the end
+static bool TakeBytes (struct SEntryReader* r, void* buf, size_t n)
+{
+    if ((size_t)(r->end - r->p) < n) {
+	errno = 0;
+	return false;
     }
+    if (n)	// buf may be NULL for an empty array
+	memcpy (buf, r->p, n);
+    r->p += n;
+    return true;
 }
 
-static inline void SetColor (enum EUIColor c, bool selected)
+/// Takes n 16 bit numbers, standard or extended, widening them into v
+static bool TakeNumbers16 (struct SEntryReader* r, int32_t* v, unsigned n)
+{
+    int16_t v16 [MaxExtValues];	// More than NNumbers
+    if (n > sizeof(v16)/sizeof(v16[0]) || !TakeBytes (r, v16, n*sizeof(int16_t)))
+	return false;
+    for (unsigned i = 0; i < n; ++i)
+	v[i] = v16[i];
+    return true;
+}
+
+static bool TakeNumbers32 (struct SEntryReader* r, int32_t* v, unsigned n)
+{
+    return TakeBytes (r, v, n*sizeof(int32_t));
+}
+
+/// FNV-1a
+static uint32_t HashName (const char* s)
+{
+    uint32_t h = 2166136261u;
+    while (*s)
+	h = (h ^ (uint8_t) *s++) * 16777619u;
+    return h;
+}
+
+/// 64-bit FNV-1a of the bytes of a compiled entry
+static uint64_t Fingerprint (const void* p, size_t n)
+{
+    uint64_t h = UINT64_C(14695981039346656037);
+    for (const uint8_t *s = (const uint8_t*) p, *e = s+n; s < e; ++s)
+	h = (h ^ *s) * UINT64_C(1099511628211);
+    return h;
+}
+
+static const char* ExtName (const struct STerminfo* ti, unsigned x)
 {
-    attrset (_color[c+selected*4]);
+    const unsigned o = ti->xname[x];
+    return o < ti->xh.strtableSize ? ti->xstrings+o : "???";
 }
 
-static void DrawLine (unsigned l, bool selected)
+/// Builds the name index of the extended values
+static void HashExtNames (struct STerminfo* ti)
 {
-    if (selected) {
-	SetColor (color_Selection, false);
-	FillRect (0, l, COLS, 1);
+    const unsigned n = ti->xh.nBooleans + ti->xh.nNumbers + ti->xh.nStrings;
+    const uint64_t t = TraceBegin();
+    for (ti->xhashSize = 8; ti->xhashSize < 2*n; ti->xhashSize *= 2) {}
+    ti->xhash = (uint16_t*) Realloc (ti->xhash, ti->xhashSize * sizeof(uint16_t));
+    memset (ti->xhash, 0, ti->xhashSize * sizeof(uint16_t));
+    for (unsigned x = 0; x < n; ++x) {
+	unsigned slot = HashName (ExtName (ti, x)) & (ti->xhashSize-1);
+	while (ti->xhash[slot])
+	    slot = (slot+1) & (ti->xhashSize-1);
+	ti->xhash[slot] = x+1;
     }
-    SetColor (color_Name, selected);
-    move (l, 1);
-    const unsigned dl = _topline+l;
-    if (dl < FirstNumber) {
-	const unsigned di = dl - FirstBoolean;
-	const char* v = "false";
-	if (di < _info.h.nBooleans && _info.abool[di])
-	    v = "true";
-	printw ("%-26s: ", GetBooleanName(di));
-	SetColor (color_Value, selected);
-	addstr (v);
-    } else if (dl < FirstString) {
-	const unsigned di = dl - FirstNumber;
-	int16_t v = -1;
-	if (di < _info.h.nNumbers)
-	    v = _info.anum[di];
-	printw ("%-26s: ", GetNumberName(di));
-	SetColor (color_Value, selected);
-	printw ("%hd", v);
-    } else if (dl < NValues) {
-	const unsigned di = dl - FirstString;
-	printw ("%-26s: ", GetStringName(di));
-	const char* s = "";
-	unsigned slen = 0;
-	if (di < _info.h.nStrings && _info.astro[di] < _info.h.strtableSize) {
-	    s = _info.strings+_info.astro[di];
-	    slen = strnlen (s, _info.h.strtableSize - _info.astro[di]);
-	}
-	SetColor (color_Value, selected);
-	for (unsigned i = 0; i < slen; ++i) {
-	    unsigned char c = s[i];
-	    if (c < ' ' || c > '~') {
-		SetColor (color_ValueSpecial, selected);
-		if (c < ' ') {
-		    addch ('^');
-		    addch ('A'-1+c);
-		} else
-		    printw ("\\%o", c);
-		SetColor (color_Value, selected);
-	    } else
-		addch (c);
-	}
-    } else
-	addstr ("???");
+    TraceSpan ("index extended names", t, 0);
 }
 
-static void Draw (void)
+/// Returns the index of the extended value called name, or UINT_MAX
+static unsigned FindExtValue (const struct STerminfo* ti, const char* name)
 {
-    erase();
-    const unsigned nVisible = min (NValues, LINES-1), visselection = _selection-_topline;
-    for (unsigned l = 0; l < nVisible; ++l)
-	DrawLine (l, visselection == l);
-    attron (_color[color_StatusLine]);
-    FillRect (0, LINES-1, COLS, 1);
-    mvaddstr (LINES-1, 1, _info.name);
-    attroff (_color[color_StatusLine]);
+    if (!ti->xhashSize)
+	return UINT_MAX;
+    for (unsigned slot = HashName (name) & (ti->xhashSize-1); ti->xhash[slot]; slot = (slot+1) & (ti->xhashSize-1))
+	if (0 == strcmp (ExtName (ti, ti->xhash[slot]-1), name))
+	    return ti->xhash[slot]-1;
+    return UINT_MAX;
 }
 
-static void OnKey (unsigned key)
+/// Loads the extended section, if present, from r positioned after the strtable
+static bool LoadExtended (struct SEntryReader* r, struct STerminfo* ti)
 {
-    const unsigned pageSize = LINES-1;
-    if (key == KEY_ESCAPE || key == 'q')
-	_quitting = true;
-    else if (key == KEY_HOME || key == '0')
-	_selection = 0;
-    else if (key == KEY_END || key == 'G')
-	_selection = NValues-1;
-    else if (key == 'H')
-	_selection = _topline;
-    else if (key == 'M')
-	_selection = _topline+(pageSize-1)/2;
-    else if (key == 'L')
-	_selection = _topline+(pageSize-1);
-    else if ((key == KEY_UP || key == 'k') && _selection > 0)
-	--_selection;
-    else if ((key == KEY_DOWN || key == 'j') && _selection < NValues-1)
-	++_selection;
-    else if (key == KEY_PPAGE || key == 'b') {
-	if (_selection > pageSize)
-	    _selection -= pageSize;
-	else
-	    _selection = 0;
-    } else if (key == KEY_NPAGE || key == ' ') {
-	if (_selection + pageSize < NValues-1)
-	    _selection += pageSize;
-	else
-	    _selection = NValues-1;
+    struct STerminfoLayout l;
+    TerminfoLayout (&ti->h, &l);
+    struct STerminfoExtHeader xh;
+    char pad;
+    if (l.end % 2 && r->p < r->end)
+	++r->p;
+    if (r->p == r->end) {	// No extended section
+	memset (&ti->xh, 0, sizeof(ti->xh));
+	ti->xhashSize = 0;
+	return true;
+    }
+    if (!TakeBytes (r, &xh, sizeof(xh)))
+	return false;
+    const unsigned n = xh.nBooleans + xh.nNumbers + xh.nStrings;
+    if (n > MaxExtValues || xh.nStrtableItems < n) {
+	errno = 0;
+	return false;
     }
-    if (_topline > _selection)
-	_topline = _selection;
-    if (_topline + pageSize-1 < _selection)
-	_topline = _selection - (pageSize-1);
+    ti->xh = xh;
+    ti->xbool = (bool*) Realloc (ti->xbool, xh.nBooleans * sizeof(bool));
+    ti->xnum = (int32_t*) Realloc (ti->xnum, xh.nNumbers * sizeof(int32_t));
+    ti->xstro = (uint16_t*) Realloc (ti->xstro, xh.nStrings * sizeof(uint16_t));
+    ti->xname = (uint16_t*) Realloc (ti->xname, n * sizeof(uint16_t));
+    ti->xstrings = (char*) Realloc (ti->xstrings, xh.strtableSize + 1);
+    if (!TakeBytes (r, ti->xbool, xh.nBooleans * sizeof(bool))
+	    || (xh.nBooleans % 2 && !TakeBytes (r, &pad, 1))
+	    || !(ti->h.magic == TERMINFO_MAGIC_32BIT ? TakeNumbers32 : TakeNumbers16) (r, ti->xnum, xh.nNumbers)
+	    || !TakeBytes (r, ti->xstro, xh.nStrings * sizeof(uint16_t))
+	    || !TakeBytes (r, ti->xname, n * sizeof(uint16_t))
+	    || !TakeBytes (r, ti->xstrings, xh.strtableSize)) {
+	memset (&ti->xh, 0, sizeof(ti->xh));
+	return false;
+    }
+    ti->xstrings[xh.strtableSize] = 0;
+    // Name offsets are relative to the end of the value strings
+    unsigned namesBase = 0;
+    for (unsigned i = 0; i < xh.nStrings; ++i)
+	if (ti->xstro[i] < xh.strtableSize)
+	    namesBase = max (namesBase, ti->xstro[i] + strlen (ti->xstrings+ti->xstro[i]) + 1);
+    for (unsigned i = 0; i < n; ++i)
+	ti->xname[i] = min (ti->xname[i] + namesBase, UINT16_MAX);
+    HashExtNames (ti);
+    return true;
 }
 
-//}}}-------------------------------------------------------------------
-//{{{ Process housekeeping
+/// Loads the entry in the n bytes at p into ti. On failure, errno is 0 if it
+/// is not terminfo. Numbers are widened to 32 bits by a reader selected once
+/// from the magic.
+static bool LoadTerminfoBytes (const void* p, size_t n, struct STerminfo* ti)
+{
+    struct SEntryReader r = { (const char*) p, (const char*) p + n };
+    struct STerminfoHeader h;
+    bool ok = TakeBytes (&r, &h, sizeof(h));
+    if (ok && !IsTerminfoHeader (&h)) {
+	errno = 0;
+	ok = false;
+    }
+    if (ok) {
+	char pad;
+	ti->h = h;
+	ti->name = (char*) Realloc (ti->name, ti->h.nameSize * sizeof(char));
+	ti->abool = (bool*) Realloc (ti->abool, ti->h.nBooleans * sizeof(bool));
+	ti->anum = (int32_t*) Realloc (ti->anum, ti->h.nNumbers * sizeof(int32_t));
+	ti->astro = (uint16_t*) Realloc (ti->astro, ti->h.nStrings * sizeof(uint16_t));
+	ti->strings = (char*) Realloc (ti->strings, ti->h.strtableSize * sizeof(char));
+	ok = TakeBytes (&r, ti->name, ti->h.nameSize * sizeof(char))
+	    && TakeBytes (&r, ti->abool, ti->h.nBooleans * sizeof(bool))
+	    && ((ti->h.nameSize + ti->h.nBooleans) % 2 == 0 || TakeBytes (&r, &pad, 1))
+	    && (ti->h.magic == TERMINFO_MAGIC_32BIT ? TakeNumbers32 : TakeNumbers16) (&r, ti->anum, ti->h.nNumbers)
+	    && TakeBytes (&r, ti->astro, ti->h.nStrings * sizeof(uint16_t))
+	    && TakeBytes (&r, ti->strings, ti->h.strtableSize * sizeof(char))
+	    && LoadExtended (&r, ti);
+	ti->name[ti->h.nameSize-1] = 0;
+    }
+    return ok;
+}
 
-static void InitUI (void)
+/// Loads the entry in the file fd into ti, reading it whole and parsing
+/// it in memory. On failure, errno is 0 if it is not terminfo.
+static bool LoadTerminfoFd (int fd, struct STerminfo* ti)
 {
-    if (!initscr()) {
-	puts ("Error: unable to initialize UI");
-	exit (EXIT_FAILURE);
+    size_t size = 0;
+    char* data = ReadWholeFd (fd, &size);
+    if (!data)
+	return false;
+    const bool ok = LoadTerminfoBytes (data, size, ti);
+    const int lerrno = errno;
+    Free (data);
+    errno = lerrno;
+    return ok;
+}
+
+/// Loads tifile into ti. On failure, errno is 0 if the file is not terminfo.
+static bool LoadTerminfo (const char* tifile, struct STerminfo* ti)
+{
+    const uint64_t t = TraceBegin();
+    int fd = open (tifile, O_RDONLY);
+    CountSyscall (syscall_Open, 0);
+    TraceSpan ("open", t, 0);
+    if (fd < 0)
+	return false;
+    const bool ok = LoadTerminfoFd (fd, ti);
+    const int lerrno = errno;
+    close (fd);
+    CountSyscall (syscall_Close, 0);
+    TraceSpan ("load", t, 0);
+    errno = lerrno;
+    return ok;
+}
+
+/// Returns one past the last NUL in the n bytes at s, 0 if there is none
+static unsigned StringsLimit (const char* s, unsigned n)
+{
+    unsigned i = n;
+#if __SSE2__
+    for (; i >= 16; i -= 16) {
+	unsigned m = _mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i*)(s+i-16)), _mm_setzero_si128()));
+	if (m)
+	    return i-16 + 32-__builtin_clz(m);
     }
-    cbreak();
-    noecho();
-    keypad (stdscr, true);
-    curs_set (false);
-    if (has_colors()) {
-	start_color();
-	use_default_colors();
-	for (unsigned i = 0; i < NColors; ++i) {
-	    init_pair (i+1, c_Pairs[i][0], c_Pairs[i][1]);
-	    _color[i] |= COLOR_PAIR(i+1);
+#endif
+    while (i && s[i-1])
+	--i;
+    return i;
+}
+
+/// Checks that each of the n offsets is below limit, or, if absentOk,
+/// is one of the absent (0xffff) or cancelled (0xfffe) markers.
+static bool ValidOffsets (const uint16_t* o, unsigned n, unsigned limit, bool absentOk)
+{
+    unsigned i = 0;
+#if __SSE2__
+    const __m128i vlimit = _mm_set1_epi16 (limit), vone = _mm_set1_epi16 (1),
+		vabsent = _mm_set1_epi16 (absentOk ? -1 : 0), vzero = _mm_setzero_si128();
+    for (; i+8 <= n; i += 8) {
+	const __m128i v = _mm_loadu_si128 ((const __m128i*)(o+i));
+	// Saturating limit-v is 0 when v >= limit; absent markers are all ones with the low bit set
+	const __m128i outside = _mm_cmpeq_epi16 (_mm_subs_epu16 (vlimit, v), vzero);
+	const __m128i absent = _mm_and_si128 (_mm_cmpeq_epi16 (_mm_or_si128 (v, vone), _mm_set1_epi16 (-1)), vabsent);
+	if (_mm_movemask_epi8 (_mm_andnot_si128 (absent, outside)))
+	    return false;
+    }
+#endif
+    for (; i < n; ++i)
+	if (o[i] >= limit && !(absentOk && o[i] >= 0xfffe))
+	    return false;
+    return true;
+}
+
+/// Checks that every string and extended name offset of ti starts a
+/// NUL-terminated string inside its table. A string starting below the
+/// last NUL of its table is terminated by it, so one scan per table
+/// and one range compare per offset suffice.
+static bool ValidTerminfo (const struct STerminfo* ti)
+{
+    const uint64_t t = TraceBegin();
+    const unsigned xlimit = StringsLimit (ti->xstrings, ti->xh.strtableSize);
+    const bool ok = ValidOffsets (ti->astro, ti->h.nStrings, StringsLimit (ti->strings, ti->h.strtableSize), true)
+	&& ValidOffsets (ti->xstro, ti->xh.nStrings, xlimit, true)
+	&& ValidOffsets (ti->xname, ti->xh.nBooleans + ti->xh.nNumbers + ti->xh.nStrings, xlimit, false);
+    TraceSpan ("validate", t, 0);
+    return ok;
+}
+
+static void FreeTerminfo (struct STerminfo* ti)
+{
+    Free (ti->name);
+    Free (ti->abool);
+    Free (ti->anum);
+    Free (ti->astro);
+    Free (ti->strings);
+    Free (ti->xbool);
+    Free (ti->xnum);
+    Free (ti->xstro);
+    Free (ti->xname);
+    Free (ti->xstrings);
+    Free (ti->xhash);
+    memset (ti, 0, sizeof(*ti));
+}
+
+static bool TerminfoBoolean (const struct STerminfo* ti, unsigned i)
+{
+    return i < ti->h.nBooleans && ti->abool[i];
+}
+
+static int TerminfoNumber (const struct STerminfo* ti, unsigned i)
+{
+    return i < ti->h.nNumbers ? ti->anum[i] : -1;
+}
+
+/// Returns string i and sets *plen to its length, or returns NULL if absent
+static const char* TerminfoString (const struct STerminfo* ti, unsigned i, unsigned* plen)
+{
+    if (i >= ti->h.nStrings || ti->astro[i] >= ti->h.strtableSize)
+	return NULL;
+    const char* s = ti->strings + ti->astro[i];
+    *plen = strnlen (s, ti->h.strtableSize - ti->astro[i]);
+    return s;
+}
+
+/// Standard values, followed by the extended booleans, numbers, and strings
+static unsigned TerminfoRows (const struct STerminfo* ti)
+{
+    return NValues + ti->xh.nBooleans + ti->xh.nNumbers + ti->xh.nStrings;
+}
+
+static void GetRowValue (const struct STerminfo* ti, unsigned r, struct SValue* v)
+{
+    v->string = NULL;
+    v->slen = 0;
+    v->number = -1;
+    if (r < FirstNumber) {
+	v->name = ValueName (r);
+	v->type = type_Boolean;
+	v->number = TerminfoBoolean (ti, r-FirstBoolean);
+    } else if (r < FirstString) {
+	v->name = ValueName (r);
+	v->type = type_Number;
+	v->number = TerminfoNumber (ti, r-FirstNumber);
+    } else if (r < NValues) {
+	v->name = ValueName (r);
+	v->type = type_String;
+	v->string = TerminfoString (ti, r-FirstString, &v->slen);
+    } else {
+	const unsigned x = r-NValues;
+	v->name = ExtName (ti, x);
+	if (x < ti->xh.nBooleans) {
+	    v->type = type_Boolean;
+	    v->number = ti->xbool[x];
+	} else if (x < ti->xh.nBooleans + ti->xh.nNumbers) {
+	    v->type = type_Number;
+	    v->number = ti->xnum[x-ti->xh.nBooleans];
+	} else {
+	    v->type = type_String;
+	    const unsigned o = ti->xstro[x-ti->xh.nBooleans-ti->xh.nNumbers];
+	    if (o < ti->xh.strtableSize) {
+		v->string = ti->xstrings+o;
+		v->slen = strlen (v->string);
+	    }
 	}
     }
 }
 
-static void EventLoop (void)
+static bool SameValue (const struct SValue* a, const struct SValue* b)
 {
-    while (!_quitting) {
-	Draw();
-	int key = getch();
-	if (key > 0)
-	    OnKey (key);
+    return a->type == b->type && a->number == b->number && !a->string == !b->string
+	&& a->slen == b->slen && (!a->string || 0 == memcmp (a->string, b->string, a->slen));
+}
+
+/// Sets bit r of changed for each row of b that differs in a.
+/// Extended values are matched by name.
+static unsigned DiffTerminfo (const struct STerminfo* a, const struct STerminfo* b, uint8_t* changed)
+{
+    unsigned nChanged = 0;
+    const unsigned nRows = TerminfoRows (b);
+    memset (changed, 0, (nRows+7)/8);
+    for (unsigned r = 0; r < nRows; ++r) {
+	struct SValue av, bv;
+	GetRowValue (b, r, &bv);
+	unsigned ar = r;
+	if (r >= NValues && (ar = FindExtValue (a, bv.name)) != UINT_MAX)
+	    ar += NValues;
+	bool differs = (ar == UINT_MAX);
+	if (!differs) {
+	    GetRowValue (a, ar, &av);
+	    differs = !SameValue (&av, &bv);
+	}
+	if (differs) {
+	    changed[r/8] |= 1u << (r%8);
+	    ++nChanged;
+	}
     }
+    return nChanged;
 }
 
-static void CleanupUI (void)
+//}}}-------------------------------------------------------------------
+//{{{ Single value queries
+
+/// Returns the value row with the given long name or capname, or NValues if there is none.
+/// Termcap codes are not matched; several of them are also capnames of other values.
+static unsigned FindValueByName (const char* name)
 {
-    endwin();
-    if (_info.name)
-	free (_info.name);
-    if (_info.abool)
-	free (_info.abool);
-    if (_info.astro)
-	free (_info.astro);
-    if (_info.astro)
-	free (_info.strings);
-    memset (&_info, 0, sizeof(_info));
+    for (unsigned r = 0; r < NValues; ++r)
+	if (0 == strcmp (ValueName (r), name))
+	    return r;
+    for (unsigned r = 0; r < NValues; ++r)
+	if (0 == strcmp (ValueShortName (r), name))
+	    return r;
+    return NValues;
 }
 
-static void OnQuitSignal (int sig)
+/// Prints s with control characters in ^X notation, other nonprintables in octal
+static void PrintEscaped (const char* s, unsigned slen)
 {
-    static bool s_FirstTime = true;
-    if (!s_FirstTime) {
-	psignal (sig, "[S] Double error");
-	_Exit (EXIT_FAILURE);
+    for (unsigned i = 0; i < slen; ++i) {
+	unsigned char c = s[i];
+	if (c < ' ')
+	    printf ("^%c", 'A'-1+c);
+	else if (c > '~')
+	    printf ("\\%o", c);
+	else
+	    putchar (c);
     }
-    s_FirstTime = false;
-    CleanupUI();
-    psignal (sig, "[S] Error");
-    exit (EXIT_FAILURE);
 }
 
-static void OnMsgSignal (int sig UNUSED)
+static void PrintValue (const struct SValue* v)
 {
-    Draw();
-    refresh();
+    if (v->type == type_Boolean)
+	fputs (v->number == 1 ? "true" : "false", stdout);
+    else if (v->type == type_Number)
+	printf ("%d", v->number);
+    else if (v->string)
+	PrintEscaped (v->string, v->slen);
 }
 
-static void InstallCleanupHandlers (void)
+/// Prints value row r of tifile. Only the header, the value slot, and for
+/// strings the bytes of the string are read, each with a single pread.
+static bool QueryValue (const char* tifile, unsigned r)
 {
-//{{{2 Signal sets for OnQuitSignal and OnMsgSignal
-#define S(sn) (1u<<(sn))
-    enum {
-	sigset_Quit = S(SIGINT)|S(SIGQUIT)|S(SIGTERM)|S(SIGILL)|S(SIGABRT)
-			|S(SIGBUS)|S(SIGFPE)|S(SIGSYS)|S(SIGSEGV)|S(SIGALRM)
-			|S(SIGXCPU),
-	sigset_Msg = S(SIGHUP)|S(SIGCHLD)|S(SIGWINCH)|S(SIGURG)|S(SIGXFSZ)
-			|S(SIGUSR1)|S(SIGUSR2)|S(SIGPIPE)
-    };
-#undef S
-//}}}2
-    atexit (CleanupUI);
-    for (unsigned b = 0; b < NSIG; ++b) {
-	if (sigset_Quit & (1u << b))
-	    signal (b, OnQuitSignal);
-	else if (sigset_Msg & (1u << b))
-	    signal (b, OnMsgSignal);
+    int fd = open (tifile, O_RDONLY);
+    CountSyscall (syscall_Open, 0);
+    if (fd < 0)
+	return false;
+    struct STerminfoHeader h;
+    const ssize_t hbr = Pread (fd, &h, sizeof(h), 0);
+    if (hbr >= 0)
+	errno = 0;	// So that a short read fails as not terminfo
+    bool ok = (sizeof(h) == hbr);
+    if (ok && !IsTerminfoHeader (&h))
+	ok = false;
+    struct STerminfoLayout l;
+    TerminfoLayout (&h, &l);
+    if (!ok)
+	;
+    else if (r < FirstNumber) {
+	const unsigned di = r - FirstBoolean;
+	uint8_t v = 0;
+	ok = (di >= h.nBooleans || sizeof(v) == Pread (fd, &v, sizeof(v), l.booleans + di));
+	if (ok)
+	    fputs (v == 1 ? "true" : "false", stdout);
+    } else if (r < FirstString) {
+	const unsigned di = r - FirstNumber;
+	int32_t v = -1;
+	if (di < h.nNumbers && l.numberSize == sizeof(int16_t)) {
+	    int16_t v16;
+	    ok = (sizeof(v16) == Pread (fd, &v16, sizeof(v16), l.numbers + di*sizeof(v16)));
+	    v = v16;
+	} else if (di < h.nNumbers)
+	    ok = (sizeof(v) == Pread (fd, &v, sizeof(v), l.numbers + di*sizeof(v)));
+	if (ok)
+	    printf ("%d", v);
+    } else {
+	const unsigned di = r - FirstString;
+	uint16_t o = UINT16_MAX;
+	ok = (di >= h.nStrings || sizeof(o) == Pread (fd, &o, sizeof(o), l.strings + di*sizeof(o)));
+	// Most strings are short; read more only if the first chunk has no NUL
+	char sbuf [256], *s = sbuf;
+	for (size_t ssz = sizeof(sbuf), sread = 0; ok && o < h.strtableSize; ssz *= 2) {
+	    if (s != sbuf)
+		s = (char*) Realloc (s, ssz);
+	    else if (sread) {
+		s = (char*) memcpy (Realloc (NULL, ssz), sbuf, sread);
+	    }
+	    const size_t toread = min (ssz, h.strtableSize - o) - sread;
+	    const ssize_t br = Pread (fd, s+sread, toread, l.strtable + o + sread);
+	    if (br <= 0) {
+		ok = false;
+		break;
+	    }
+	    const char* z = memchr (s+sread, 0, br);
+	    sread += br;
+	    if (z || sread >= (size_t)(h.strtableSize - o)) {
+		PrintEscaped (s, z ? (unsigned)(z-s) : sread);
+		break;
+	    }
+	}
+	if (s != sbuf)
+	    Free (s);
     }
+    close (fd);
+    CountSyscall (syscall_Close, 0);
+    return ok;
 }
 
-int main (int argc, const char* const* argv)
+static const char* TerminfoDbPath (void)
 {
-    InstallCleanupHandlers();
-    const char* termname = "xterm";
-    if (argc == 2)
-	termname = argv[1];
-    else if (argc > 2) {
-	puts ("Usage: tiedit [termname]");
-	return EXIT_SUCCESS;
-    }
-    const char* tidbpath = TERMINFO_DB_PATH;
     const char* tidbenv = getenv("TERMINFO");
-    if (tidbenv)
-	tidbpath = tidbenv;
-    char termfile [PATH_MAX];
-    snprintf (termfile, sizeof(termfile), "%s/%c/%s", tidbpath, termname[0], termname);
-    LoadTerminfo (termfile);
-    InitUI();
-    EventLoop();
-    return EXIT_SUCCESS;
+    return tidbenv ? tidbenv : TERMINFO_DB_PATH;
 }
 
 //}}}-------------------------------------------------------------------
-//{{{ Value name tables
+//{{{ Entry cache
 
-#define _(s) "\0" s
-static const char c_BooleanNames[] =
-    _("auto_left_margin")
-    _("auto_right_margin")
-    _("no_esc_ctlc")
-    _("ceol_standout_glitch")
-    _("eat_newline_glitch")
-    _("erase_overstrike")
-    _("generic_type")
-    _("hard_copy")
-    _("has_meta_key")
-    _("has_status_line")
-    _("insert_null_glitch")
-    _("memory_above")
-    _("memory_below")
-    _("move_insert_mode")
-    _("move_standout_mode")
-    _("over_strike")
-    _("status_line_esc_ok")
-    _("dest_tabs_magic_smso")
-    _("tilde_glitch")
-    _("transparent_underline")
-    _("xon_xoff")
-    _("needs_xon_xoff")
-    _("prtr_silent")
-    _("hard_cursor")
-    _("non_rev_rmcup")
-    _("no_pad_char")
-    _("non_dest_scroll_region")
-    _("can_change")
-    _("back_color_erase")
-    _("hue_lightness_saturation")
-    _("col_addr_glitch")
-    _("cr_cancels_micro_mode")
-    _("has_print_wheel")
-    _("row_addr_glitch")
-    _("semi_auto_right_margin")
-    _("cpi_changes_res")
-    _("lpi_changes_res")
-    _("backspaces_with_bs")
-    _("crt_no_scrolling")
-    _("no_correctly_working_cr")
-    _("gnu_has_meta_key")
-    _("linefeed_is_newline")
-    _("has_hardware_tabs")
-    _("return_does_clr_eol")
-;
-static const char c_NumberNames[] =
-    _("columns")
-    _("init_tabs")
-    _("lines")
-    _("lines_of_memory")
-    _("magic_cookie_glitch")
-    _("padding_baud_rate")
-    _("virtual_terminal")
-    _("width_status_line")
-    _("num_labels")
-    _("label_height")
-    _("label_width")
-    _("max_attributes")
-    _("maximum_windows")
-    _("max_colors")
-    _("max_pairs")
-    _("no_color_video")
-    _("buffer_capacity")
-    _("dot_vert_spacing")
-    _("dot_horz_spacing")
-    _("max_micro_address")
-    _("max_micro_jump")
-    _("micro_col_size")
-    _("micro_line_size")
-    _("number_of_pins")
-    _("output_res_char")
-    _("output_res_line")
-    _("output_res_horz_inch")
-    _("output_res_vert_inch")
-    _("print_rate")
-    _("wide_char_size")
-    _("buttons")
-    _("bit_image_entwining")
-    _("bit_image_type")
-    _("magic_cookie_glitch_ul")
-    _("carriage_return_delay")
-    _("new_line_delay")
-    _("backspace_delay")
-    _("horizontal_tab_delay")
-    _("number_of_function_keys")
-;
-static const char c_StringNames[] =
-    _("back_tab")
-    _("bell")
-    _("carriage_return")
-    _("change_scroll_region")
-    _("clear_all_tabs")
-    _("clear_screen")
-    _("clr_eol")
-    _("clr_eos")
-    _("column_address")
-    _("command_character")
-    _("cursor_address")
-    _("cursor_down")
-    _("cursor_home")
-    _("cursor_invisible")
-    _("cursor_left")
-    _("cursor_mem_address")
-    _("cursor_normal")
-    _("cursor_right")
-    _("cursor_to_ll")
-    _("cursor_up")
-    _("cursor_visible")
-    _("delete_character")
-    _("delete_line")
-    _("dis_status_line")
-    _("down_half_line")
-    _("enter_alt_charset_mode")
-    _("enter_blink_mode")
-    _("enter_bold_mode")
-    _("enter_ca_mode")
-    _("enter_delete_mode")
-    _("enter_dim_mode")
-    _("enter_insert_mode")
-    _("enter_secure_mode")
-    _("enter_protected_mode")
-    _("enter_reverse_mode")
-    _("enter_standout_mode")
-    _("enter_underline_mode")
-    _("erase_chars")
-    _("exit_alt_charset_mode")
-    _("exit_attribute_mode")
-    _("exit_ca_mode")
-    _("exit_delete_mode")
-    _("exit_insert_mode")
-    _("exit_standout_mode")
-    _("exit_underline_mode")
-    _("flash_screen")
-    _("form_feed")
-    _("from_status_line")
-    _("init_1string")
-    _("init_2string")
-    _("init_3string")
-    _("init_file")
-    _("insert_character")
-    _("insert_line")
-    _("insert_padding")
-    _("key_backspace")
-    _("key_catab")
-    _("key_clear")
-    _("key_ctab")
-    _("key_dc")
-    _("key_dl")
-    _("key_down")
-    _("key_eic")
-    _("key_eol")
-    _("key_eos")
-    _("key_f0")
-    _("key_f1")
-    _("key_f10")
-    _("key_f2")
-    _("key_f3")
-    _("key_f4")
-    _("key_f5")
-    _("key_f6")
-    _("key_f7")
-    _("key_f8")
-    _("key_f9")
-    _("key_home")
-    _("key_ic")
-    _("key_il")
-    _("key_left")
-    _("key_ll")
-    _("key_npage")
-    _("key_ppage")
-    _("key_right")
-    _("key_sf")
-    _("key_sr")
-    _("key_stab")
-    _("key_up")
-    _("keypad_local")
-    _("keypad_xmit")
-    _("lab_f0")
-    _("lab_f1")
-    _("lab_f10")
-    _("lab_f2")
-    _("lab_f3")
-    _("lab_f4")
-    _("lab_f5")
-    _("lab_f6")
-    _("lab_f7")
-    _("lab_f8")
-    _("lab_f9")
-    _("meta_off")
-    _("meta_on")
-    _("newline")
-    _("pad_char")
-    _("parm_dch")
-    _("parm_delete_line")
-    _("parm_down_cursor")
-    _("parm_ich")
-    _("parm_index")
-    _("parm_insert_line")
-    _("parm_left_cursor")
-    _("parm_right_cursor")
-    _("parm_rindex")
-    _("parm_up_cursor")
-    _("pkey_key")
-    _("pkey_local")
-    _("pkey_xmit")
-    _("print_screen")
-    _("prtr_off")
-    _("prtr_on")
-    _("repeat_char")
-    _("reset_1string")
-    _("reset_2string")
-    _("reset_3string")
-    _("reset_file")
-    _("restore_cursor")
-    _("row_address")
-    _("save_cursor")
-    _("scroll_forward")
-    _("scroll_reverse")
-    _("set_attributes")
-    _("set_tab")
-    _("set_window")
-    _("tab")
-    _("to_status_line")
-    _("underline_char")
-    _("up_half_line")
-    _("init_prog")
-    _("key_a1")
-    _("key_a3")
-    _("key_b2")
-    _("key_c1")
-    _("key_c3")
-    _("prtr_non")
-    _("char_padding")
-    _("acs_chars")
-    _("plab_norm")
-    _("key_btab")
-    _("enter_xon_mode")
-    _("exit_xon_mode")
-    _("enter_am_mode")
-    _("exit_am_mode")
-    _("xon_character")
-    _("xoff_character")
-    _("ena_acs")
-    _("label_on")
-    _("label_off")
-    _("key_beg")
-    _("key_cancel")
-    _("key_close")
-    _("key_command")
-    _("key_copy")
-    _("key_create")
-    _("key_end")
-    _("key_enter")
-    _("key_exit")
-    _("key_find")
-    _("key_help")
-    _("key_mark")
-    _("key_message")
-    _("key_move")
-    _("key_next")
-    _("key_open")
-    _("key_options")
-    _("key_previous")
-    _("key_print")
-    _("key_redo")
-    _("key_reference")
-    _("key_refresh")
-    _("key_replace")
-    _("key_restart")
-    _("key_resume")
-    _("key_save")
-    _("key_suspend")
-    _("key_undo")
-    _("key_sbeg")
-    _("key_scancel")
-    _("key_scommand")
-    _("key_scopy")
-    _("key_screate")
-    _("key_sdc")
-    _("key_sdl")
-    _("key_select")
-    _("key_send")
-    _("key_seol")
-    _("key_sexit")
-    _("key_sfind")
-    _("key_shelp")
-    _("key_shome")
-    _("key_sic")
-    _("key_sleft")
-    _("key_smessage")
-    _("key_smove")
-    _("key_snext")
-    _("key_soptions")
-    _("key_sprevious")
-    _("key_sprint")
-    _("key_sredo")
-    _("key_sreplace")
-    _("key_sright")
-    _("key_srsume")
-    _("key_ssave")
-    _("key_ssuspend")
-    _("key_sundo")
-    _("req_for_input")
-    _("key_f11")
-    _("key_f12")
-    _("key_f13")
-    _("key_f14")
-    _("key_f15")
-    _("key_f16")
-    _("key_f17")
-    _("key_f18")
-    _("key_f19")
-    _("key_f20")
-    _("key_f21")
-    _("key_f22")
-    _("key_f23")
-    _("key_f24")
-    _("key_f25")
-    _("key_f26")
-    _("key_f27")
-    _("key_f28")
-    _("key_f29")
-    _("key_f30")
-    _("key_f31")
-    _("key_f32")
-    _("key_f33")
-    _("key_f34")
-    _("key_f35")
-    _("key_f36")
-    _("key_f37")
-    _("key_f38")
-    _("key_f39")
-    _("key_f40")
-    _("key_f41")
-    _("key_f42")
-    _("key_f43")
-    _("key_f44")
-    _("key_f45")
-    _("key_f46")
-    _("key_f47")
-    _("key_f48")
-    _("key_f49")
-    _("key_f50")
-    _("key_f51")
-    _("key_f52")
-    _("key_f53")
-    _("key_f54")
-    _("key_f55")
-    _("key_f56")
-    _("key_f57")
-    _("key_f58")
-    _("key_f59")
-    _("key_f60")
-    _("key_f61")
-    _("key_f62")
-    _("key_f63")
-    _("clr_bol")
-    _("clear_margins")
-    _("set_left_margin")
-    _("set_right_margin")
-    _("label_format")
-    _("set_clock")
-    _("display_clock")
-    _("remove_clock")
-    _("create_window")
-    _("goto_window")
-    _("hangup")
-    _("dial_phone")
-    _("quick_dial")
-    _("tone")
-    _("pulse")
-    _("flash_hook")
-    _("fixed_pause")
-    _("wait_tone")
-    _("user0")
-    _("user1")
-    _("user2")
-    _("user3")
-    _("user4")
-    _("user5")
-    _("user6")
-    _("user7")
-    _("user8")
-    _("user9")
-    _("orig_pair")
-    _("orig_colors")
-    _("initialize_color")
-    _("initialize_pair")
-    _("set_color_pair")
-    _("set_foreground")
-    _("set_background")
-    _("change_char_pitch")
-    _("change_line_pitch")
-    _("change_res_horz")
-    _("change_res_vert")
-    _("define_char")
-    _("enter_doublewide_mode")
-    _("enter_draft_quality")
-    _("enter_italics_mode")
-    _("enter_leftward_mode")
-    _("enter_micro_mode")
-    _("enter_near_letter_quality")
-    _("enter_normal_quality")
-    _("enter_shadow_mode")
-    _("enter_subscript_mode")
-    _("enter_superscript_mode")
-    _("enter_upward_mode")
-    _("exit_doublewide_mode")
-    _("exit_italics_mode")
-    _("exit_leftward_mode")
-    _("exit_micro_mode")
-    _("exit_shadow_mode")
-    _("exit_subscript_mode")
-    _("exit_superscript_mode")
-    _("exit_upward_mode")
-    _("micro_column_address")
-    _("micro_down")
-    _("micro_left")
-    _("micro_right")
-    _("micro_row_address")
-    _("micro_up")
-    _("order_of_pins")
-    _("parm_down_micro")
-    _("parm_left_micro")
-    _("parm_right_micro")
-    _("parm_up_micro")
-    _("select_char_set")
-    _("set_bottom_margin")
-    _("set_bottom_margin_parm")
-    _("set_left_margin_parm")
-    _("set_right_margin_parm")
-    _("set_top_margin")
-    _("set_top_margin_parm")
-    _("start_bit_image")
-    _("start_char_set_def")
-    _("stop_bit_image")
-    _("stop_char_set_def")
-    _("subscript_characters")
-    _("superscript_characters")
-    _("these_cause_cr")
-    _("zero_motion")
-    _("char_set_names")
-    _("key_mouse")
-    _("mouse_info")
-    _("req_mouse_pos")
-    _("get_mouse")
-    _("set_a_foreground")
-    _("set_a_background")
-    _("pkey_plab")
-    _("device_type")
-    _("code_set_init")
-    _("set0_des_seq")
-    _("set1_des_seq")
-    _("set2_des_seq")
-    _("set3_des_seq")
-    _("set_lr_margin")
-    _("set_tb_margin")
-    _("bit_image_repeat")
-    _("bit_image_newline")
-    _("bit_image_carriage_return")
-    _("color_names")
-    _("define_bit_image_region")
-    _("end_bit_image_region")
-    _("set_color_band")
-    _("set_page_length")
-    _("display_pc_char")
-    _("enter_pc_charset_mode")
-    _("exit_pc_charset_mode")
-    _("enter_scancode_mode")
-    _("exit_scancode_mode")
-    _("pc_term_options")
-    _("scancode_escape")
-    _("alt_scancode_esc")
-    _("enter_horizontal_hl_mode")
-    _("enter_left_hl_mode")
-    _("enter_low_hl_mode")
-    _("enter_right_hl_mode")
-    _("enter_top_hl_mode")
-    _("enter_vertical_hl_mode")
-    _("set_a_attributes")
-    _("set_pglen_inch")
-    _("termcap_init2")
-    _("termcap_reset")
-    _("linefeed_if_not_lf")
-    _("backspace_if_not_bs")
-    _("other_non_function_keys")
-    _("arrow_key_map")
-    _("acs_ulcorner")
-    _("acs_llcorner")
-    _("acs_urcorner")
-    _("acs_lrcorner")
-    _("acs_ltee")
-    _("acs_rtee")
-    _("acs_btee")
-    _("acs_ttee")
-    _("acs_hline")
-    _("acs_vline")
-    _("acs_plus")
-    _("memory_lock")
-    _("memory_unlock")
-    _("box_chars_1")
-;
-#undef _
-
-static const char* GetStrtableEntry (unsigned idx, unsigned maxstr, const char* strs, unsigned strssize)
-{
-#if __i386__ || __x86_64__
-    unsigned i = min(idx,maxstr)+1;
-    do {
-	__asm__("repnz\tscasb":"+D"(strs),"+c"(strssize):"a"('\0'));
-    } while (--i);
-#else
-    const char* strsend = strs+strssize;
-    for (unsigned i = min(idx,maxstr)+1; --i && strs < strsend;)
-	strs += strlen(strs)+1;
-#endif
-    return strs;
-}
+enum { ENTRY_CACHE_BYTES = 1024*1024 };
+
+/// A parsed entry, identified by the file it was loaded from
+struct SCachedEntry {
+    struct STerminfo	info;	///< First, so the entry can be found from it
+    dev_t		dev;
+    ino_t		ino;
+    struct timespec	mtime;
+    size_t		size;	///< Heap bytes held by the entry
+    uint64_t		lastUse;
+    unsigned		refs;	///< Acquired entries are not evicted
+};
+
+/// Size-bounded LRU cache of parsed entries
+static struct SEntryCache {
+    pthread_mutex_t		lock;
+    struct SCachedEntry**	e;
+    unsigned		n;
+    unsigned		capacity;
+    size_t		size;
+    uint64_t		clock;
+    unsigned long	hits;
+    unsigned long	misses;
+    unsigned long	evictions;
+} _cache = {PTHREAD_MUTEX_INITIALIZER,NULL,0,0,0,0,0,0,0};
+
+static size_t TerminfoSize (const struct STerminfo* ti)
+{
+    return sizeof(struct SCachedEntry) + ti->h.nameSize
+	+ ti->h.nBooleans * sizeof(bool)
+	+ ti->h.nNumbers * sizeof(int32_t)
+	+ ti->h.nStrings * sizeof(uint16_t)
+	+ ti->h.strtableSize
+	+ ti->xh.nBooleans * sizeof(bool)
+	+ ti->xh.nNumbers * sizeof(int32_t)
+	+ ti->xh.nStrings * sizeof(uint16_t)
+	+ (ti->xh.nBooleans + ti->xh.nNumbers + ti->xh.nStrings) * sizeof(uint16_t)
+	+ ti->xh.strtableSize + 1
+	+ ti->xhashSize * sizeof(uint16_t);
+}
+
+/// Evicts least recently used unreferenced entries until the cache fits.
+/// Called with the cache locked.
+static void TrimEntryCache (void)
+{
+    while (_cache.size > ENTRY_CACHE_BYTES) {
+	unsigned lru = _cache.n;
+	for (unsigned i = 0; i < _cache.n; ++i)
+	    if (!_cache.e[i]->refs && (lru >= _cache.n || _cache.e[i]->lastUse < _cache.e[lru]->lastUse))
+		lru = i;
+	if (lru >= _cache.n)
+	    break;
+	struct SCachedEntry* e = _cache.e[lru];
+	_cache.size -= e->size;
+	_cache.e[lru] = _cache.e[--_cache.n];
+	FreeTerminfo (&e->info);
+	Free (e);
+	++_cache.evictions;
+    }
+}
+
+static struct SCachedEntry* FindCachedEntry (const struct stat* st)
+{
+    for (unsigned i = 0; i < _cache.n; ++i) {
+	struct SCachedEntry* e = _cache.e[i];
+	if (e->dev == st->st_dev && e->ino == st->st_ino
+		&& e->mtime.tv_sec == st->st_mtim.tv_sec
+		&& e->mtime.tv_nsec == st->st_mtim.tv_nsec)
+	    return e;
+    }
+    return NULL;
+}
+
+/// Looks up tifile in the cache, loading it on a miss, or adds the entry
+/// in the size bytes at data if not NULL. The file is loaded without holding
+/// the lock, so the UI is never blocked while the prefetcher waits on a
+/// slow filesystem.
+static struct SCachedEntry* LookupTerminfo (const char* tifile, const void* data, size_t size, unsigned refs, bool* phit)
+{
+    struct stat st;
+    memset (&st, 0, sizeof(st));	// Entries in memory have no file, and are never found
+    *phit = false;
+    if (!data && 0 > stat (tifile, &st))
+	return NULL;
+    pthread_mutex_lock (&_cache.lock);
+    struct SCachedEntry* e = data ? NULL : FindCachedEntry (&st);
+    if (e) {
+	e->refs += refs;
+	e->lastUse = ++_cache.clock;
+    }
+    pthread_mutex_unlock (&_cache.lock);
+    if ((*phit = !!e))
+	return e;
+
+    e = (struct SCachedEntry*) Realloc (NULL, sizeof(struct SCachedEntry));
+    memset (e, 0, sizeof(*e));
+    if (!(data ? LoadTerminfoBytes (data, size, &e->info) : LoadTerminfo (tifile, &e->info))) {
+	const int lerrno = errno;
+	FreeTerminfo (&e->info);
+	Free (e);
+	errno = lerrno;
+	return NULL;
+    }
+    e->dev = st.st_dev;
+    e->ino = st.st_ino;
+    e->mtime = st.st_mtim;
+    e->size = TerminfoSize (&e->info);
+
+    pthread_mutex_lock (&_cache.lock);
+    struct SCachedEntry* loaded = data ? NULL : FindCachedEntry (&st);
+    if (loaded) {	// Another thread got there first
+	FreeTerminfo (&e->info);
+	Free (e);
+	e = loaded;
+    } else {
+	if (_cache.n >= _cache.capacity)
+	    _cache.e = (struct SCachedEntry**) Realloc (_cache.e, (_cache.capacity = 2*_cache.capacity + 16) * sizeof(struct SCachedEntry*));
+	_cache.e[_cache.n++] = e;
+	_cache.size += e->size;
+    }
+    e->refs += refs;
+    e->lastUse = ++_cache.clock;
+    TrimEntryCache();
+    pthread_mutex_unlock (&_cache.lock);
+    return e;
+}
+
+static struct STerminfo* AcquireEntry (const char* tifile, const void* data, size_t size)
+{
+    bool hit;
+    struct SCachedEntry* e = LookupTerminfo (tifile, data, size, 1, &hit);
+    pthread_mutex_lock (&_cache.lock);
+    if (hit)
+	++_cache.hits;
+    else
+	++_cache.misses;
+    pthread_mutex_unlock (&_cache.lock);
+    return e ? &e->info : NULL;
+}
+
+/// Returns the parsed entry in tifile, loading it if not cached.
+/// The entry stays valid until released with ReleaseTerminfo.
+static struct STerminfo* AcquireTerminfo (const char* tifile)
+{
+    return AcquireEntry (tifile, NULL, 0);
+}
+
+/// AcquireTerminfo for an entry in memory that has no file, such as
+/// one extracted from an archive or read from stdin
+static struct STerminfo* AcquireTerminfoBytes (const void* data, size_t size)
+{
+    return AcquireEntry (NULL, data, size);
+}
+
+static void ReleaseTerminfo (struct STerminfo* ti)
+{
+    pthread_mutex_lock (&_cache.lock);
+    if (ti && ((struct SCachedEntry*) ti)->refs)
+	--((struct SCachedEntry*) ti)->refs;
+    pthread_mutex_unlock (&_cache.lock);
+}
+
+static void ClearEntryCache (void)
+{
+    pthread_mutex_lock (&_cache.lock);
+    for (unsigned i = 0; i < _cache.n; ++i) {
+	FreeTerminfo (&_cache.e[i]->info);
+	Free (_cache.e[i]);
+    }
+    Free (_cache.e);
+    _cache.e = NULL;
+    _cache.n = _cache.capacity = 0;
+    _cache.size = 0;
+    pthread_mutex_unlock (&_cache.lock);
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Prefetcher
+
+enum { NPrefetch = 3 };
+
+/// Loads entries around the browser cursor into the cache in the background
+static struct SPrefetcher {
+    pthread_mutex_t	lock;
+    pthread_cond_t	wake;
+    char		path [NPrefetch][PATH_MAX];	///< Pending, most likely first
+    unsigned		n;
+    bool		started;
+    bool		stop;
+    pthread_t		tid;
+    unsigned long	loads;
+} _prefetch = {PTHREAD_MUTEX_INITIALIZER,PTHREAD_COND_INITIALIZER,{""},0,false,false,0,0};
+
+static void* PrefetchThread (void* arg UNUSED)
+{
+    TraceThread ("prefetch");
+    for (;;) {
+	char tifile [PATH_MAX];
+	pthread_mutex_lock (&_prefetch.lock);
+	while (!_prefetch.n && !_prefetch.stop)
+	    pthread_cond_wait (&_prefetch.wake, &_prefetch.lock);
+	if (_prefetch.stop) {
+	    pthread_mutex_unlock (&_prefetch.lock);
+	    break;
+	}
+	strcpy (tifile, _prefetch.path[0]);
+	memmove (_prefetch.path[0], _prefetch.path[1], --_prefetch.n * sizeof(_prefetch.path[0]));
+	pthread_mutex_unlock (&_prefetch.lock);
+	bool hit;
+	if (LookupTerminfo (tifile, NULL, 0, 0, &hit) && !hit) {
+	    pthread_mutex_lock (&_prefetch.lock);
+	    ++_prefetch.loads;
+	    pthread_mutex_unlock (&_prefetch.lock);
+	}
+    }
+    return NULL;
+}
+
+/// Replaces pending requests with the selected browser entry, which is
+/// the most likely to be opened, and its neighbours, the one in the
+/// direction of the last move first.
+static void PrefetchAroundSelection (int direction)
+{
+    const unsigned nRows = BrowserRows(), sel = _terms.selection;
+    if (sel >= nRows)
+	return;
+    unsigned rows [NPrefetch], n = 0;
+    rows[n++] = sel;
+    if (direction >= 0 && sel+1 < nRows)
+	rows[n++] = sel+1;
+    if (sel > 0)
+	rows[n++] = sel-1;
+    if (direction < 0 && sel+1 < nRows)
+	rows[n++] = sel+1;
+
+    pthread_mutex_lock (&_prefetch.lock);
+    if (!_prefetch.started && !_prefetch.stop)
+	_prefetch.started = (0 == pthread_create (&_prefetch.tid, NULL, PrefetchThread, NULL));
+    for (_prefetch.n = 0; _prefetch.n < n; ++_prefetch.n)
+	snprintf (_prefetch.path[_prefetch.n], PATH_MAX, "%s/%s", TerminfoDbPath(), _terms.name[BrowserTerm(rows[_prefetch.n])]);
+    pthread_cond_signal (&_prefetch.wake);
+    pthread_mutex_unlock (&_prefetch.lock);
+}
+
+/// Waits for the prefetcher to finish its load, before the cache is freed
+static void StopPrefetch (void)
+{
+    pthread_mutex_lock (&_prefetch.lock);
+    _prefetch.stop = true;
+    const bool started = _prefetch.started;
+    _prefetch.started = false;
+    pthread_cond_signal (&_prefetch.wake);
+    pthread_mutex_unlock (&_prefetch.lock);
+    if (started)
+	pthread_join (_prefetch.tid, NULL);
+}
+
+static void PrintStats (void)
+{
+    printf ("I/O: %lu open, %lu read, %lu close, %lu mmap, %lu bytes read\n",
+	    atomic_load (&_counters.calls[syscall_Open]), atomic_load (&_counters.calls[syscall_Read]),
+	    atomic_load (&_counters.calls[syscall_Close]), atomic_load (&_counters.calls[syscall_Mmap]),
+	    atomic_load (&_counters.bytesRead));
+    printf ("Heap: %lu Realloc calls, %ld bytes at peak\n",
+	    atomic_load (&_counters.reallocs), atomic_load (&_counters.peakHeap));
+    printf ("Entry cache: %lu hits, %lu misses, %lu evictions, %u entries in %zu bytes\n",
+	    _cache.hits, _cache.misses, _cache.evictions, _cache.n, _cache.size);
+    if (_prefetch.started)
+	printf ("Prefetcher: %lu entries loaded\n", _prefetch.loads);
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Database scanner
+
+static int CompareNames (const void* a, const void* b)
+{
+    return strcmp (*(const char* const*)a, *(const char* const*)b);
+}
+
+/// Returns the sorted names in dir, skipping dotfiles
+static unsigned ReadSortedDir (const char* dir, char*** pnames)
+{
+    unsigned n = 0, capacity = 0;
+    char** names = NULL;
+    DIR* d = opendir (dir);
+    CountSyscall (syscall_Open, 0);
+    if (d) {
+	for (const struct dirent* e; (e = readdir (d));) {
+	    if (e->d_name[0] == '.')
+		continue;
+	    if (n >= capacity)
+		names = (char**) Realloc (names, (capacity = capacity ? 2*capacity : 64) * sizeof(char*));
+	    names[n++] = StrDup (e->d_name);
+	}
+	closedir (d);
+	CountSyscall (syscall_Close, 0);
+	qsort (names, n, sizeof(char*), CompareNames);
+    }
+    *pnames = names;
+    return n;
+}
+
+/// Pushes path and the names from its header, or just the path if not terminfo
+static void PushScannedName (const char* dbpath, const char* path)
+{
+    char names [4096] = "";
+    char tifile [PATH_MAX];
+    int fd = -1;
+    if ((size_t) snprintf (tifile, sizeof(tifile), "%s/%s", dbpath, path) < sizeof(tifile)) {
+	fd = open (tifile, O_RDONLY);
+	CountSyscall (syscall_Open, 0);
+    }
+    if (fd >= 0) {
+	struct STerminfoHeader h;
+	// The names section is the same in both formats
+	if (ReadBytes (fd, &h, sizeof(h)) && (h.magic == TERMINFO_MAGIC || h.magic == TERMINFO_MAGIC_32BIT)) {
+	    const unsigned nr = min (h.nameSize, sizeof(names)-1);
+	    if (!ReadBytes (fd, names, nr))
+		names[0] = 0;
+	    names[nr] = 0;
+	}
+	close (fd);
+	CountSyscall (syscall_Close, 0);
+    }
+    const size_t pathsz = strlen(path)+1, namessz = strlen(names)+1;
+    char* rec = (char*) Realloc (NULL, pathsz+namessz);
+    memcpy (rec, path, pathsz);
+    memcpy (rec+pathsz, names, namessz);
+    PushScanRecord (rec);
+}
+
+static void PushScanRecord (char* rec)
+{
+    const unsigned head = atomic_load_explicit (&_scanRing.head, memory_order_relaxed);
+    while (head - atomic_load_explicit (&_scanRing.tail, memory_order_acquire) >= NAME_RING_SIZE) {
+	if (atomic_load_explicit (&_scanRing.stop, memory_order_relaxed)) {
+	    Free (rec);
+	    return;
+	}
+	nanosleep (&(struct timespec){0,1000000}, NULL);
+    }
+    _scanRing.slot[head % NAME_RING_SIZE] = rec;
+    atomic_store_explicit (&_scanRing.head, head+1, memory_order_release);
+}
+
+/// Enumerates the terminfo database, one directory level at a time.
+/// Both levels are sorted, so the names arrive in sorted order.
+static void* ScanThread (void* dbpath)
+{
+    TraceThread ("scan");
+    char** dirs;
+    const unsigned ndirs = ReadSortedDir ((const char*) dbpath, &dirs);
+    for (unsigned i = 0; i < ndirs; ++i) {
+	char path [PATH_MAX];
+	snprintf (path, sizeof(path), "%s/%s", (const char*) dbpath, dirs[i]);
+	char** ents;
+	const unsigned nents = ReadSortedDir (path, &ents);
+	for (unsigned j = 0; j < nents; ++j) {
+	    snprintf (path, sizeof(path), "%s/%s", dirs[i], ents[j]);
+	    if (!atomic_load_explicit (&_scanRing.stop, memory_order_relaxed))
+		PushScannedName ((const char*) dbpath, path);
+	    Free (ents[j]);
+	}
+	Free (ents);
+	Free (dirs[i]);
+    }
+    Free (dirs);
+    atomic_store_explicit (&_scanRing.done, true, memory_order_release);
+    return NULL;
+}
+
+static void StartScan (void)
+{
+    _scanRing.started = (0 == pthread_create (&_scanRing.tid, NULL, ScanThread, (void*) TerminfoDbPath()));
+    if (!_scanRing.started)
+	atomic_store (&_scanRing.done, true);
+}
+
+/// Ends the scan early and frees the names it queued and the UI did not collect
+static void StopScan (void)
+{
+    atomic_store (&_scanRing.stop, true);
+    if (_scanRing.started)
+	pthread_join (_scanRing.tid, NULL);
+    _scanRing.started = false;
+    unsigned tail = atomic_load (&_scanRing.tail);
+    for (const unsigned head = atomic_load (&_scanRing.head); tail != head; ++tail)
+	Free (_scanRing.slot[tail % NAME_RING_SIZE]);
+    atomic_store (&_scanRing.tail, tail);
+}
+
+/// Appends the fuzzy search key for rec: the entry's names without the
+/// trailing description, or the file name when the entry has no names.
+static void AddSearchKey (const char* rec)
+{
+    const char* names = rec+strlen(rec)+1;
+    const char* desc = strrchr (names, '|');
+    unsigned keysz = desc ? (unsigned)(desc-names) : strlen(names);
+    if (!keysz) {
+	const char* basename = strchr (rec, '/');
+	names = basename ? basename+1 : rec;
+	keysz = strlen(names);
+    }
+    keysz = min (keysz, UINT16_MAX);
+    if (_terms.keysSize + keysz + 16 > _terms.keysCapacity) {
+	_terms.keysCapacity = 2*_terms.keysCapacity + keysz + 4096;
+	_terms.keys = (char*) Realloc (_terms.keys, _terms.keysCapacity);
+    }
+    char* key = _terms.keys + _terms.keysSize;
+    uint64_t keychars = 0;
+    for (unsigned i = 0; i < keysz; ++i) {
+	char c = names[i];
+	if (c >= 'A' && c <= 'Z')
+	    c += 'a'-'A';
+	key[i] = c;
+	keychars |= UINT64_C(1) << (c % 64);
+    }
+    memset (key+keysz, 0, 16);
+    _terms.keyOffset[_terms.n] = _terms.keysSize;
+    _terms.keySize[_terms.n] = keysz;
+    _terms.keyChars[_terms.n] = keychars;
+    _terms.keysSize += keysz;
+}
+
+/// Moves names queued by the scanner into the browser list
+static bool CollectScannedNames (void)
+{
+    unsigned tail = atomic_load_explicit (&_scanRing.tail, memory_order_relaxed);
+    const unsigned head = atomic_load_explicit (&_scanRing.head, memory_order_acquire);
+    if (tail == head)
+	return false;
+    if (_terms.n + (head - tail) > _terms.capacity) {
+	_terms.capacity = 2*_terms.capacity + NAME_RING_SIZE;
+	_terms.name = (char**) Realloc (_terms.name, _terms.capacity * sizeof(char*));
+	_terms.keyOffset = (uint32_t*) Realloc (_terms.keyOffset, _terms.capacity * sizeof(uint32_t));
+	_terms.keySize = (uint16_t*) Realloc (_terms.keySize, _terms.capacity * sizeof(uint16_t));
+	_terms.keyChars = (uint64_t*) Realloc (_terms.keyChars, _terms.capacity * sizeof(uint64_t));
+    }
+    const unsigned first = _terms.n;
+    for (; tail != head; ++tail) {
+	_terms.name[_terms.n] = _scanRing.slot[tail % NAME_RING_SIZE];
+	AddSearchKey (_terms.name[_terms.n]);
+	++_terms.n;
+    }
+    atomic_store_explicit (&_scanRing.tail, tail, memory_order_release);
+    if (_filter.qlen)
+	FilterNewTerms (first);
+    return true;
+}
+
+static bool ScanFinished (void)
+{
+    return atomic_load_explicit (&_scanRing.done, memory_order_acquire)
+	&& atomic_load_explicit (&_scanRing.head, memory_order_acquire)
+	    == atomic_load_explicit (&_scanRing.tail, memory_order_relaxed);
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Parallel database scans
+
+/// Open-addressed set of file identities. Inode 0 marks an empty slot.
+struct SFileSet {
+    struct SFileId {
+	dev_t	dev;
+	ino_t	ino;
+    }*		slot;
+    unsigned	n;
+    unsigned	capacity;	///< A power of 2
+};
+
+static unsigned FileIdSlot (const struct SFileSet* s, dev_t dev, ino_t ino)
+{
+    const uint64_t h = ((uint64_t) ino ^ (uint64_t) dev << 40) * UINT64_C(0x9e3779b97f4a7c15);
+    unsigned slot = (h >> 32) & (s->capacity-1);
+    while (s->slot[slot].ino && (s->slot[slot].ino != ino || s->slot[slot].dev != dev))
+	slot = (slot+1) & (s->capacity-1);
+    return slot;
+}
+
+/// Adds the file to the set, returns false if it was already there
+static bool AddFileId (struct SFileSet* s, dev_t dev, ino_t ino)
+{
+    if (2*(s->n+1) > s->capacity) {	// Rehash at half full
+	struct SFileSet g = { NULL, s->n, max (256, 2*s->capacity) };
+	g.slot = (struct SFileId*) Realloc (NULL, g.capacity * sizeof(struct SFileId));
+	memset (g.slot, 0, g.capacity * sizeof(struct SFileId));
+	for (unsigned i = 0; i < s->capacity; ++i)
+	    if (s->slot[i].ino)
+		g.slot[FileIdSlot (&g, s->slot[i].dev, s->slot[i].ino)] = s->slot[i];
+	Free (s->slot);
+	*s = g;
+    }
+    const unsigned slot = FileIdSlot (s, dev, ino);
+    if (s->slot[slot].ino)
+	return false;
+    s->slot[slot].dev = dev;
+    s->slot[slot].ino = ino;
+    ++s->n;
+    return true;
+}
+
+/// Returns the sorted paths of all entries in dbpath. Unless links is
+/// set, aliases linked to an already listed file are skipped, so each
+/// entry is listed once.
+static unsigned ListDatabase (const char* dbpath, bool links, char*** ppaths)
+{
+    unsigned n = 0, capacity = 0;
+    char** paths = NULL;
+    struct SFileSet seen = { NULL, 0, 0 };
+    char** dirs;
+    const unsigned ndirs = ReadSortedDir (dbpath, &dirs);
+    for (unsigned i = 0; i < ndirs; ++i) {
+	char path [PATH_MAX];
+	snprintf (path, sizeof(path), "%s/%s", dbpath, dirs[i]);
+	char** ents;
+	const unsigned nents = ReadSortedDir (path, &ents);
+	for (unsigned j = 0; j < nents; ++j) {
+	    struct stat st;
+	    snprintf (path, sizeof(path), "%s/%s/%s", dbpath, dirs[i], ents[j]);
+	    Free (ents[j]);
+	    if (0 > stat (path, &st) || !S_ISREG(st.st_mode))
+		continue;
+	    if (!links && !AddFileId (&seen, st.st_dev, st.st_ino))
+		continue;
+	    if (n >= capacity)
+		paths = (char**) Realloc (paths, (capacity = 2*capacity + 256) * sizeof(char*));
+	    paths[n++] = StrDup (path);
+	}
+	Free (ents);
+	Free (dirs[i]);
+    }
+    Free (dirs);
+    Free (seen.slot);
+    *ppaths = paths;
+    return n;
+}
+
+static void FreePaths (char** paths, unsigned n)
+{
+    for (unsigned i = 0; i < n; ++i)
+	Free (paths[i]);
+    Free (paths);
+}
+
+enum { MAX_WORKERS = 64 };
+
+static unsigned NumWorkers (void)
+{
+    const long ncpu = sysconf (_SC_NPROCESSORS_ONLN);
+    return ncpu > 1 ? min (ncpu, MAX_WORKERS) : 1;
+}
+
+/// Called for item i by the given worker
+typedef void (*pfnWorkItem)(void* ctx, unsigned worker, unsigned i);
+
+/// Items 0 to n-1, claimed one at a time by the workers
+struct SWorkQueue {
+    unsigned		n;
+    atomic_uint		next;		///< Next item to claim
+    pfnWorkItem		fn;
+    void*		ctx;
+};
+
+struct SWorker {
+    struct SWorkQueue*	q;
+    unsigned		worker;
+};
+
+static void* WorkerThread (void* arg)
+{
+    const struct SWorker* w = (const struct SWorker*) arg;
+    char tname [16];
+    snprintf (tname, sizeof(tname), "worker %u", w->worker);
+    TraceThread (tname);
+    for (unsigned i; (i = atomic_fetch_add (&w->q->next, 1)) < w->q->n;)
+	w->q->fn (w->q->ctx, w->worker, i);
+    return NULL;
+}
+
+/// Calls fn for items 0 to n-1 on nWorkers threads, the calling thread being worker 0
+static void RunWorkers (unsigned n, unsigned nWorkers, pfnWorkItem fn, void* ctx)
+{
+    struct SWorkQueue q = { n, 0, fn, ctx };
+    struct SWorker w [MAX_WORKERS];
+    pthread_t tid [MAX_WORKERS];
+    unsigned nStarted = 0;
+    for (; nStarted < nWorkers; ++nStarted) {
+	w[nStarted].q = &q;
+	w[nStarted].worker = nStarted;
+	if (nStarted && 0 != pthread_create (&tid[nStarted], NULL, WorkerThread, &w[nStarted]))
+	    break;
+    }
+    WorkerThread (&w[0]);
+    for (unsigned i = 1; i < nStarted; ++i)
+	pthread_join (tid[i], NULL);
+}
+
+/// Called for entry i of a scan by the given worker, with its path relative
+/// to the database, and NULL ti if it failed to load
+typedef void (*pfnScanEntry)(void* ctx, unsigned worker, unsigned i, const char* path, const struct STerminfo* ti);
+
+/// A parallel scan over a list of entry files
+struct SScan {
+    char* const*	path;
+    unsigned		prefixLen;	///< Of the database path, skipped in paths passed to fn
+    atomic_uint		nFailed;
+    pfnScanEntry	fn;
+    void*		ctx;
+    struct STerminfo	ti [MAX_WORKERS];	///< Reused by each worker for all its entries
+};
+
+/// Each worker reuses one STerminfo for all its entries, so a scan
+/// allocates only when an entry is larger than any before it. Entries
+/// are validated when loaded, so scan callbacks may trust all offsets.
+static void ScanEntry (void* ctx, unsigned worker, unsigned i)
+{
+    struct SScan* scan = (struct SScan*) ctx;
+    struct STerminfo* ti = &scan->ti[worker];
+    const bool ok = LoadTerminfo (scan->path[i], ti) && ValidTerminfo (ti);
+    if (!ok)
+	atomic_fetch_add (&scan->nFailed, 1);
+    scan->fn (scan->ctx, worker, i, scan->path[i] + scan->prefixLen, ok ? ti : NULL);
+}
+
+/// Calls fn for every path listed from dbpath on nWorkers threads,
+/// returns the number of entries that failed to load or validate
+static unsigned RunScan (const char* dbpath, char* const* path, unsigned n, unsigned nWorkers, pfnScanEntry fn, void* ctx)
+{
+    struct SScan* scan = (struct SScan*) Realloc (NULL, sizeof(struct SScan));
+    memset (scan, 0, sizeof(*scan));
+    scan->path = path;
+    scan->prefixLen = strlen (dbpath) + 1;
+    scan->fn = fn;
+    scan->ctx = ctx;
+    RunWorkers (n, nWorkers, ScanEntry, scan);
+    for (unsigned i = 0; i < nWorkers; ++i)
+	FreeTerminfo (&scan->ti[i]);
+    const unsigned nFailed = atomic_load (&scan->nFailed);
+    Free (scan);
+    return nFailed;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Entry streams
+//
+// Compiled entries may be read from a pipe, one after another as when
+// the files are concatenated. Each entry's size follows from its header
+// and, when present, its extended header, so entries are split without
+// seeking. An extended section is present when the bytes after the
+// standard part are not the magic of the next entry.
+
+enum { STREAM_RING_SIZE = 64*1024 };	///< Initial size, grown for larger entries
+
+/// Bytes read from fd and not yet consumed, in a power-of-2 ring
+struct SByteRing {
+    uint8_t*	p;
+    size_t	capacity;
+    size_t	head;		///< Total bytes read
+    size_t	tail;		///< Total bytes consumed
+    int		fd;
+    bool	eof;
+    uint8_t*	entry;		///< Copy of an entry that wraps around the ring
+    size_t	entryCapacity;
+};
+
+/// Copies n bytes at offset o past the tail into dst
+static void RingPeek (const struct SByteRing* r, size_t o, void* dst, size_t n)
+{
+    const size_t start = (r->tail + o) & (r->capacity-1), first = min (n, r->capacity - start);
+    memcpy (dst, r->p + start, first);
+    memcpy ((uint8_t*) dst + first, r->p, n - first);
+}
+
+/// Reads until at least n bytes are available, returns false at end of input
+static bool RingFill (struct SByteRing* r, size_t n)
+{
+    if (n > r->capacity) {	// Unwrap into a larger ring
+	size_t capacity = r->capacity ? r->capacity : STREAM_RING_SIZE;
+	while (capacity < n)
+	    capacity *= 2;
+	uint8_t* p = (uint8_t*) Realloc (NULL, capacity);
+	if (r->p)
+	    RingPeek (r, 0, p, r->head - r->tail);
+	Free (r->p);
+	r->p = p;
+	r->capacity = capacity;
+	r->head -= r->tail;
+	r->tail = 0;
+    }
+    while (r->head - r->tail < n && !r->eof) {
+	const size_t start = r->head & (r->capacity-1);
+	const size_t space = min (r->capacity - (r->head - r->tail), r->capacity - start);
+	const ssize_t br = read (r->fd, r->p + start, space);
+	CountSyscall (syscall_Read, br);
+	if (br > 0)
+	    r->head += br;
+	else if (br == 0 || errno != EINTR)
+	    r->eof = true;
+    }
+    return r->head - r->tail >= n;
+}
+
+/// Returns the size of the entry at the tail, or 0 if the input ends or is not terminfo
+static size_t StreamEntrySize (struct SByteRing* r)
+{
+    struct STerminfoHeader h;
+    if (!RingFill (r, sizeof(h)))
+	return 0;
+    RingPeek (r, 0, &h, sizeof(h));
+    if (!IsTerminfoHeader (&h))
+	return 0;
+    struct STerminfoLayout l;
+    TerminfoLayout (&h, &l);
+    uint16_t magic;
+    if (!RingFill (r, l.end + sizeof(magic)))
+	return r->head - r->tail >= (size_t) l.end ? (size_t) l.end : 0;
+    RingPeek (r, l.end, &magic, sizeof(magic));
+    if (magic == TERMINFO_MAGIC || magic == TERMINFO_MAGIC_32BIT)
+	return l.end;
+    const size_t xstart = l.end + l.end%2;
+    struct STerminfoExtHeader xh;
+    if (!RingFill (r, xstart + sizeof(xh)))
+	return l.end;
+    RingPeek (r, xstart, &xh, sizeof(xh));
+    const unsigned n = xh.nBooleans + xh.nNumbers + xh.nStrings;
+    if (n > MaxExtValues || xh.nStrtableItems < n)
+	return l.end;
+    return xstart + sizeof(xh) + xh.nBooleans + xh.nBooleans%2 + xh.nNumbers*l.numberSize
+	+ (xh.nStrings + n) * sizeof(uint16_t) + xh.strtableSize;
+}
+
+/// Consumes the next entry of the stream, returning its bytes, valid
+/// until the next call, or NULL at the end of the stream. The entry is
+/// parsed in place in the ring unless it wraps around its end.
+static const uint8_t* NextStreamEntry (struct SByteRing* r, size_t* psize)
+{
+    const size_t size = StreamEntrySize (r);
+    if (!size || !RingFill (r, size))
+	return NULL;
+    const size_t start = r->tail & (r->capacity-1);
+    const uint8_t* e = r->p + start;
+    if (size > r->capacity - start) {
+	if (size > r->entryCapacity)
+	    r->entry = (uint8_t*) Realloc (r->entry, r->entryCapacity = size);
+	RingPeek (r, 0, r->entry, size);
+	e = r->entry;
+    }
+    r->tail += size;
+    *psize = size;
+    return e;
+}
+
+/// Makes a database-like path from the primary name of ti, as "x/xterm"
+static void StreamEntryPath (const struct STerminfo* ti, char* path, size_t pathsz)
+{
+    snprintf (path, pathsz, "%c/%.*s", ti->name[0], (int) strcspn (ti->name, "|"), ti->name);
+}
+
+/// Calls fn for each entry in the stream on stdin fd, in order, returns
+/// the number that failed to load or validate. Input that is not terminfo
+/// ends the stream, and is reported on stderr, out of the way of exported
+/// data, as an error like a failed entry.
+static unsigned RunStreamScan (int fd, pfnScanEntry fn, void* ctx)
+{
+    struct SByteRing r = { NULL, 0, 0, 0, fd, false, NULL, 0 };
+    struct STerminfo ti;
+    memset (&ti, 0, sizeof(ti));
+    unsigned i = 0, nFailed = 0;
+    size_t size;
+    for (const uint8_t* e; (e = NextStreamEntry (&r, &size)); ++i) {
+	char path [NAME_MAX+3] = "-";
+	const bool ok = LoadTerminfoBytes (e, size, &ti) && ValidTerminfo (&ti);
+	if (ok)
+	    StreamEntryPath (&ti, path, sizeof(path));
+	else
+	    ++nFailed;
+	fn (ctx, 0, i, path, ok ? &ti : NULL);
+    }
+    if (r.head != r.tail || !i) {
+	if (!i)
+	    fputs ("Error: stdin is not a terminfo entry\n", stderr);
+	else
+	    fprintf (stderr, "Error: the input after entry %u on stdin is not a terminfo entry\n", i);
+	++nFailed;
+    }
+    FreeTerminfo (&ti);
+    Free (r.entry);
+    Free (r.p);
+    return nFailed;
+}
+
+/// Returns a new copy of the first entry on fd, or NULL with errno 0 if there is none
+static uint8_t* FirstStreamEntry (int fd, size_t* psize)
+{
+    struct SByteRing r = { NULL, 0, 0, 0, fd, false, NULL, 0 };
+    const uint8_t* e = NextStreamEntry (&r, psize);
+    uint8_t* copy = e ? (uint8_t*) memcpy (Realloc (NULL, *psize), e, *psize) : NULL;
+    Free (r.entry);
+    Free (r.p);
+    if (!copy)
+	errno = 0;
+    return copy;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ String interning
+
+/// Strings mapped to dense ids, with an open-addressed hash index
+struct SStringTable {
+    char*	pool;
+    uint32_t*	offset;		///< Of each string in pool, by id
+    uint32_t*	index;		///< id+1 by hash, 0 if empty
+    unsigned	n;
+    unsigned	capacity;
+    unsigned	poolSize;
+    unsigned	poolCapacity;
+    unsigned	indexSize;	///< A power of 2, at least twice n
+};
+
+static const char* InternedString (const struct SStringTable* t, unsigned id)
+{
+    return t->pool + t->offset[id];
+}
+
+static void RehashStrings (struct SStringTable* t)
+{
+    t->indexSize = t->indexSize ? 2*t->indexSize : 64;
+    t->index = (uint32_t*) Realloc (t->index, t->indexSize * sizeof(uint32_t));
+    memset (t->index, 0, t->indexSize * sizeof(uint32_t));
+    for (unsigned id = 0; id < t->n; ++id) {
+	unsigned slot = HashName (InternedString (t, id)) & (t->indexSize-1);
+	while (t->index[slot])
+	    slot = (slot+1) & (t->indexSize-1);
+	t->index[slot] = id+1;
+    }
+}
+
+/// Returns the id of s, adding it if new
+static unsigned InternString (struct SStringTable* t, const char* s)
+{
+    if (2*t->n >= t->indexSize)
+	RehashStrings (t);
+    unsigned slot = HashName (s) & (t->indexSize-1);
+    for (; t->index[slot]; slot = (slot+1) & (t->indexSize-1))
+	if (0 == strcmp (InternedString (t, t->index[slot]-1), s))
+	    return t->index[slot]-1;
+    const unsigned ssz = strlen(s)+1;
+    if (t->poolSize + ssz > t->poolCapacity) {
+	t->poolCapacity = 2*t->poolCapacity + ssz + 4096;
+	t->pool = (char*) Realloc (t->pool, t->poolCapacity);
+    }
+    if (t->n >= t->capacity) {
+	t->capacity = 2*t->capacity + 64;
+	t->offset = (uint32_t*) Realloc (t->offset, t->capacity * sizeof(uint32_t));
+    }
+    memcpy (t->pool + t->poolSize, s, ssz);
+    t->offset[t->n] = t->poolSize;
+    t->poolSize += ssz;
+    t->index[slot] = t->n+1;
+    return t->n++;
+}
+
+static void FreeStringTable (struct SStringTable* t)
+{
+    Free (t->pool);
+    Free (t->offset);
+    Free (t->index);
+    memset (t, 0, sizeof(*t));
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Extended capability census
+
+/// Per-worker tally of extended value names
+struct SCensusWorker {
+    struct SStringTable	names;
+    unsigned		(*count)[3];	///< Entries defining the name, by EValueType
+    unsigned		capacity;
+};
+
+/// Extended value names across the database
+struct SCensus {
+    struct SCensusWorker	w [MAX_WORKERS];
+    const char* const*		query;	///< Names to report entries for
+    unsigned			nQuery;
+    uint8_t*			found;	///< EValueType+1 of each query name in each entry
+};
+
+static void CensusEntry (void* ctx, unsigned worker, unsigned i, const char* path UNUSED, const struct STerminfo* ti)
+{
+    struct SCensus* c = (struct SCensus*) ctx;
+    struct SCensusWorker* w = &c->w[worker];
+    if (!ti)
+	return;
+    for (unsigned r = NValues; r < TerminfoRows (ti); ++r) {
+	struct SValue v;
+	GetRowValue (ti, r, &v);
+	const unsigned id = InternString (&w->names, v.name);
+	if (id >= w->capacity) {
+	    const unsigned oldcap = w->capacity;
+	    w->capacity = w->names.capacity;
+	    w->count = Realloc (w->count, w->capacity * sizeof(w->count[0]));
+	    memset (&w->count[oldcap], 0, (w->capacity-oldcap) * sizeof(w->count[0]));
+	}
+	++w->count[id][v.type];
+    }
+    for (unsigned q = 0; q < c->nQuery; ++q) {
+	const unsigned x = FindExtValue (ti, c->query[q]);
+	if (x != UINT_MAX) {
+	    struct SValue v;
+	    GetRowValue (ti, NValues+x, &v);
+	    c->found[i*c->nQuery+q] = v.type+1;
+	}
+    }
+}
+
+struct SCensusRow {
+    const char*	name;
+    unsigned	count [3];
+    unsigned	total;
+};
+
+static int CompareCensusRows (const void* a, const void* b)
+{
+    const struct SCensusRow *ra = (const struct SCensusRow*) a, *rb = (const struct SCensusRow*) b;
+    if (ra->total != rb->total)
+	return ra->total > rb->total ? -1 : 1;
+    return strcmp (ra->name, rb->name);
+}
+
+/// Scans the database for extended value names and prints how many
+/// entries define each, by type. Names defined with more than one type
+/// are marked as conflicts. Entries defining each of the nQuery names
+/// in query are then listed.
+static int CensusMain (const char* const* query, unsigned nQuery)
+{
+    const char* dbpath = TerminfoDbPath();
+    char** paths;
+    const unsigned n = ListDatabase (dbpath, false, &paths);
+    const unsigned nWorkers = NumWorkers();
+    struct SCensus c;
+    memset (&c, 0, sizeof(c));
+    c.query = query;
+    c.nQuery = nQuery;
+    if (nQuery) {
+	c.found = (uint8_t*) Realloc (NULL, n*nQuery);
+	memset (c.found, 0, n*nQuery);
+    }
+    const unsigned nFailed = RunScan (dbpath, paths, n, nWorkers, CensusEntry, &c);
+
+    // Merge worker tallies
+    struct SStringTable names;
+    memset (&names, 0, sizeof(names));
+    struct SCensusRow* rows = NULL;
+    unsigned nRows = 0;
+    for (unsigned wi = 0; wi < nWorkers; ++wi) {
+	const struct SCensusWorker* w = &c.w[wi];
+	for (unsigned id = 0; id < w->names.n; ++id) {
+	    const unsigned gid = InternString (&names, InternedString (&w->names, id));
+	    if (gid >= nRows) {
+		rows = (struct SCensusRow*) Realloc (rows, (nRows = gid+1) * sizeof(struct SCensusRow));
+		memset (&rows[gid], 0, sizeof(rows[gid]));
+	    }
+	    for (unsigned t = 0; t < 3; ++t) {
+		rows[gid].count[t] += w->count[id][t];
+		rows[gid].total += w->count[id][t];
+	    }
+	}
+    }
+    for (unsigned id = 0; id < nRows; ++id)
+	rows[id].name = InternedString (&names, id);
+    qsort (rows, nRows, sizeof(struct SCensusRow), CompareCensusRows);
+
+    printf ("%u entries, %u rejected, %u extended names\n\n", n, nFailed, nRows);
+    printf ("%-16s %8s %8s %8s %8s\n", "Name", "Entries", "Boolean", "Number", "String");
+    for (unsigned i = 0; i < nRows; ++i) {
+	const struct SCensusRow* r = &rows[i];
+	const bool conflict = (!!r->count[type_Boolean] + !!r->count[type_Number] + !!r->count[type_String] > 1);
+	printf ("%-16s %8u %8u %8u %8u%s\n", r->name, r->total,
+		r->count[type_Boolean], r->count[type_Number], r->count[type_String],
+		conflict ? "  type conflict" : "");
+    }
+    static const char c_TypeNames[][8] = { "boolean", "number", "string" };
+    for (unsigned q = 0; q < nQuery; ++q) {
+	printf ("\n%s:\n", query[q]);
+	for (unsigned i = 0; i < n; ++i)
+	    if (c.found[i*nQuery+q])
+		printf ("    %-32s %s\n", paths[i]+strlen(dbpath)+1, c_TypeNames[c.found[i*nQuery+q]-1]);
+    }
+
+    Free (rows);
+    FreeStringTable (&names);
+    for (unsigned wi = 0; wi < nWorkers; ++wi) {
+	FreeStringTable (&c.w[wi].names);
+	Free (c.w[wi].count);
+    }
+    Free (c.found);
+    FreePaths (paths, n);
+    return EXIT_SUCCESS;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Export
+
+/// A growable output buffer
+struct SBuffer {
+    char*	p;
+    unsigned	n;
+    unsigned	capacity;
+};
+
+static void BufferAppend (struct SBuffer* b, const void* s, unsigned n)
+{
+    if (b->n + n > b->capacity) {
+	b->capacity = max (2*b->capacity, b->n + n + 1024);
+	b->p = (char*) Realloc (b->p, b->capacity);
+    }
+    memcpy (b->p + b->n, s, n);
+    b->n += n;
+}
+
+static void BufferAppendStr (struct SBuffer* b, const char* s)
+{
+    BufferAppend (b, s, strlen(s));
+}
+
+static void BufferAppendNumber (struct SBuffer* b, int v)
+{
+    char nbuf [16];
+    BufferAppend (b, nbuf, snprintf (nbuf, sizeof(nbuf), "%d", v));
+}
+
+/// Appends s as a quoted JSON string. Bytes that are not printable
+/// ASCII are written as \u00XX, so the output is valid for any input.
+static void BufferAppendJson (struct SBuffer* b, const char* s, unsigned slen)
+{
+    BufferAppend (b, "\"", 1);
+    for (unsigned i = 0; i < slen; ++i) {
+	const unsigned char c = s[i];
+	char ebuf [8];
+	if (c == '"' || c == '\\')
+	    BufferAppend (b, ebuf, snprintf (ebuf, sizeof(ebuf), "\\%c", c));
+	else if (c < ' ' || c > '~')
+	    BufferAppend (b, ebuf, snprintf (ebuf, sizeof(ebuf), "\\u%04x", c));
+	else
+	    BufferAppend (b, &c, 1);
+    }
+    BufferAppend (b, "\"", 1);
+}
+
+/// Appends s as a CSV field, quoted if needed, with control characters
+/// in ^X notation and other nonprintables in octal, as PrintEscaped.
+static void BufferAppendCsv (struct SBuffer* b, const char* s, unsigned slen)
+{
+    bool quote = (slen && s[0] == ' ');
+    for (unsigned i = 0; i < slen && !quote; ++i)
+	quote = (s[i] == ',' || s[i] == '"');
+    if (quote)
+	BufferAppend (b, "\"", 1);
+    for (unsigned i = 0; i < slen; ++i) {
+	const unsigned char c = s[i];
+	char ebuf [8];
+	if (c < ' ')
+	    BufferAppend (b, ebuf, snprintf (ebuf, sizeof(ebuf), "^%c", 'A'-1+c));
+	else if (c > '~')
+	    BufferAppend (b, ebuf, snprintf (ebuf, sizeof(ebuf), "\\%o", c));
+	else if (c == '"')
+	    BufferAppend (b, "\"\"", 2);
+	else
+	    BufferAppend (b, &c, 1);
+    }
+    if (quote)
+	BufferAppend (b, "\"", 1);
+}
+
+enum EExportFormat {
+    export_Ndjson,
+    export_Csv
+};
+
+/// Defined values are true booleans, non-negative numbers, and present strings
+static bool IsDefinedValue (const struct SValue* v)
+{
+    return v->type == type_String ? v->string != NULL : v->number >= 0;
+}
+
+/// {"path":"x/xterm","names":"xterm|...","booleans":{...},"numbers":{...},"strings":{...}}
+static void FormatNdjson (struct SBuffer* b, const char* path, const struct STerminfo* ti)
+{
+    static const char c_Sections[][16] = { ",\"booleans\":{", "},\"numbers\":{", "},\"strings\":{" };
+    BufferAppendStr (b, "{\"path\":");
+    BufferAppendJson (b, path, strlen(path));
+    BufferAppendStr (b, ",\"names\":");
+    BufferAppendJson (b, ti->name, strlen(ti->name));
+    for (unsigned t = type_Boolean; t <= type_String; ++t) {
+	BufferAppendStr (b, c_Sections[t]);
+	const char* sep = "";
+	for (unsigned r = 0; r < TerminfoRows (ti); ++r) {
+	    struct SValue v;
+	    GetRowValue (ti, r, &v);
+	    if (v.type != t || !IsDefinedValue (&v) || (t == type_Boolean && !v.number))
+		continue;
+	    BufferAppendStr (b, sep);
+	    sep = ",";
+	    BufferAppendJson (b, v.name, strlen(v.name));
+	    BufferAppend (b, ":", 1);
+	    if (t == type_Boolean)
+		BufferAppendStr (b, "true");
+	    else if (t == type_Number)
+		BufferAppendNumber (b, v.number);
+	    else
+		BufferAppendJson (b, v.string, v.slen);
+	}
+    }
+    BufferAppendStr (b, "}}\n");
+}
+
+/// path,names, a column for each standard value, and the extended values
+/// in an infocmp-like list of name, name#number, and name=string.
+static void FormatCsv (struct SBuffer* b, const char* path, const struct STerminfo* ti)
+{
+    BufferAppendCsv (b, path, strlen(path));
+    BufferAppend (b, ",", 1);
+    BufferAppendCsv (b, ti->name, strlen(ti->name));
+    struct SBuffer ext = {NULL,0,0};
+    for (unsigned r = 0; r < TerminfoRows (ti); ++r) {
+	struct SValue v;
+	GetRowValue (ti, r, &v);
+	if (r < NValues)
+	    BufferAppend (b, ",", 1);
+	if (!IsDefinedValue (&v) || (v.type == type_Boolean && !v.number))
+	    continue;
+	struct SBuffer* o = b;
+	if (r >= NValues) {
+	    o = &ext;
+	    if (ext.n)
+		BufferAppend (o, " ", 1);
+	    BufferAppendStr (o, v.name);
+	    if (v.type != type_Boolean)
+		BufferAppend (o, v.type == type_Number ? "#" : "=", 1);
+	}
+	if (v.type == type_Number)
+	    BufferAppendNumber (o, v.number);
+	else if (v.type == type_String && o == b)
+	    BufferAppendCsv (o, v.string, v.slen);
+	else if (v.type == type_String)
+	    BufferAppend (o, v.string, v.slen);	// Escaped with the whole list
+	else if (r < NValues)
+	    BufferAppend (o, "1", 1);
+    }
+    BufferAppend (b, ",", 1);
+    BufferAppendCsv (b, ext.p, ext.n);
+    BufferAppend (b, "\n", 1);
+    Free (ext.p);
+}
+
+enum { EXPORT_WINDOW = 256 };	///< Records formatted ahead of the one being written
+
+/// Records are formatted by the scan workers and written in path order
+/// through a reorder window, so the output does not depend on timing.
+struct SExport {
+    enum EExportFormat	format;
+    pthread_mutex_t	lock;
+    pthread_cond_t	written;	///< Signaled when next advances
+    unsigned		next;		///< Next record to write
+    atomic_uint		nRejected;
+    struct SBuffer	w [MAX_WORKERS];	///< Formatting buffer of each worker
+    struct SBuffer	slot [EXPORT_WINDOW];
+    bool		ready [EXPORT_WINDOW];
+};
+
+static void ExportEntry (void* ctx, unsigned worker, unsigned i, const char* path, const struct STerminfo* ti)
+{
+    struct SExport* x = (struct SExport*) ctx;
+    struct SBuffer* b = &x->w[worker];
+    b->n = 0;
+    if (!ti) {
+	atomic_fetch_add (&x->nRejected, 1);
+	fprintf (stderr, "Warning: skipped %s\n", path);
+    } else if (x->format == export_Csv)
+	FormatCsv (b, path, ti);
+    else
+	FormatNdjson (b, path, ti);
+
+    pthread_mutex_lock (&x->lock);
+    while (i >= x->next + EXPORT_WINDOW)
+	pthread_cond_wait (&x->written, &x->lock);
+    // Swap buffers, leaving the worker with the written one of the slot
+    struct SBuffer* s = &x->slot[i % EXPORT_WINDOW];
+    const struct SBuffer t = *s;
+    *s = *b;
+    *b = t;
+    x->ready[i % EXPORT_WINDOW] = true;
+    const unsigned oldNext = x->next;
+    for (unsigned si; x->ready[si = x->next % EXPORT_WINDOW]; ++x->next) {
+	fwrite (x->slot[si].p, 1, x->slot[si].n, stdout);
+	x->slot[si].n = 0;
+	x->ready[si] = false;
+    }
+    if (oldNext != x->next)
+	pthread_cond_broadcast (&x->written);
+    pthread_mutex_unlock (&x->lock);
+}
+
+/// Writes every entry in dbpath, or on stdin if dbpath is -, to stdout, one record per line
+static int ExportMain (const char* format, const char* dbpath)
+{
+    struct SExport* x = (struct SExport*) Realloc (NULL, sizeof(struct SExport));
+    memset (x, 0, sizeof(*x));
+    if (0 == strcmp (format, "csv"))
+	x->format = export_Csv;
+    else if (0 != strcmp (format, "ndjson")) {
+	Free (x);
+	printf ("Error: unknown export format %s\n", format);
+	return EXIT_FAILURE;
+    }
+    pthread_mutex_init (&x->lock, NULL);
+    pthread_cond_init (&x->written, NULL);
+    if (x->format == export_Csv) {
+	fputs ("path,names", stdout);
+	for (unsigned r = 0; r < NValues; ++r)
+	    printf (",%s", ValueName (r));
+	puts (",extended");
+    }
+    unsigned nFailed = 0;
+    if (0 == strcmp (dbpath, "-"))
+	nFailed = RunStreamScan (STDIN_FILENO, ExportEntry, x);
+    else {
+	char** paths;
+	const unsigned n = ListDatabase (dbpath, false, &paths);
+	RunScan (dbpath, paths, n, NumWorkers(), ExportEntry, x);
+	FreePaths (paths, n);
+    }
+    fflush (stdout);
+    pthread_cond_destroy (&x->written);
+    pthread_mutex_destroy (&x->lock);
+    for (unsigned i = 0; i < MAX_WORKERS; ++i)
+	Free (x->w[i].p);
+    for (unsigned i = 0; i < EXPORT_WINDOW; ++i)
+	Free (x->slot[i].p);
+    const unsigned nRejected = atomic_load (&x->nRejected);
+    Free (x);
+    return nRejected || nFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ LZ block codec
+//
+// A byte-oriented LZ77 in the style of LZ4. Each sequence is a token
+// byte with the literal count in the high nibble and the match length
+// minus 4 in the low nibble, either extended by bytes of 255 when 15,
+// the literals, and, unless the sequence is last, a 16-bit offset.
+
+enum {
+    LZ_MIN_MATCH	= 4,
+    LZ_HASH_BITS	= 12
+};
+
+/// Largest compressed size of n bytes
+static size_t LzBound (size_t n)
+{
+    return n + n/255 + 16;
+}
+
+static size_t LzPutLength (uint8_t* dst, size_t op, size_t len)
+{
+    if (len >= 15) {
+	for (len -= 15; len >= 255; len -= 255)
+	    dst[op++] = 255;
+	dst[op++] = len;
+    }
+    return op;
+}
+
+static size_t LzPutSequence (uint8_t* dst, size_t op, const uint8_t* lit, size_t nlit, unsigned offset, size_t mlen)
+{
+    const size_t mx = mlen ? mlen-LZ_MIN_MATCH : 0;
+    dst[op++] = (min (nlit, 15) << 4) | min (mx, 15);
+    op = LzPutLength (dst, op, nlit);
+    memcpy (dst+op, lit, nlit);
+    op += nlit;
+    if (mlen) {
+	dst[op++] = offset;
+	dst[op++] = offset >> 8;
+	op = LzPutLength (dst, op, mx);
+    }
+    return op;
+}
+
+/// Compresses n bytes of src into dst, which must have LzBound(n) bytes
+static size_t LzCompress (const uint8_t* src, size_t n, uint8_t* dst)
+{
+    uint32_t table [1u << LZ_HASH_BITS] = {0};	// Position+1 of the last 4 bytes with each hash
+    size_t ip = 0, anchor = 0, op = 0;
+    while (ip + LZ_MIN_MATCH <= n) {
+	uint32_t seq;
+	memcpy (&seq, src+ip, sizeof(seq));
+	const unsigned h = (seq * 2654435761u) >> (32-LZ_HASH_BITS);
+	const size_t cand = table[h];
+	table[h] = ip+1;
+	if (!cand || ip-(cand-1) > UINT16_MAX || 0 != memcmp (src+cand-1, src+ip, LZ_MIN_MATCH)) {
+	    ++ip;
+	    continue;
+	}
+	const size_t m = cand-1;
+	size_t len = LZ_MIN_MATCH;
+	while (ip+len < n && src[m+len] == src[ip+len])
+	    ++len;
+	op = LzPutSequence (dst, op, src+anchor, ip-anchor, ip-m, len);
+	anchor = (ip += len);
+    }
+    return LzPutSequence (dst, op, src+anchor, n-anchor, 0, 0);
+}
+
+static bool LzGetLength (const uint8_t* src, size_t n, size_t* pip, size_t* plen)
+{
+    if (*plen == 15) {
+	for (uint8_t b = 255; b == 255; *plen += b) {
+	    if (*pip >= n)
+		return false;
+	    b = src[(*pip)++];
+	}
+    }
+    return true;
+}
+
+/// Decompresses n bytes of src into exactly dn bytes of dst. Fails on
+/// malformed input without reading or writing out of bounds.
+static bool LzDecompress (const uint8_t* src, size_t n, uint8_t* dst, size_t dn)
+{
+    size_t ip = 0, op = 0;
+    while (ip < n) {
+	const uint8_t token = src[ip++];
+	size_t nlit = token >> 4;
+	if (!LzGetLength (src, n, &ip, &nlit) || nlit > n-ip || nlit > dn-op)
+	    return false;
+	memcpy (dst+op, src+ip, nlit);
+	ip += nlit;
+	op += nlit;
+	if (ip == n)
+	    break;
+	if (n-ip < 2)
+	    return false;
+	const size_t offset = src[ip] | (src[ip+1] << 8);
+	ip += 2;
+	size_t mlen = token & 15;
+	if (!LzGetLength (src, n, &ip, &mlen))
+	    return false;
+	mlen += LZ_MIN_MATCH;
+	if (!offset || offset > op || mlen > dn-op)
+	    return false;
+	for (size_t i = 0; i < mlen; ++i, ++op)	// May overlap
+	    dst[op] = dst[op-offset];
+    }
+    return op == dn;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Archives
+//
+// A .tia archive holds a terminfo database in one file:
+//   STiaHeader
+//   STiaBlock [nBlocks]
+//   STiaEntry [nEntries]
+//   STiaName [nNames], sorted by name
+//   names, NUL-terminated
+//   compressed blocks
+// Identical entries are stored once, and each block is compressed
+// separately, so one entry is read by decompressing only its block.
+
+enum {
+    TIA_MAGIC		= 0x01414954,	///< "TIA\1"
+    TIA_BLOCK_SIZE	= 64*1024	///< Target uncompressed block size
+};
+
+struct STiaHeader {
+    uint32_t	magic;
+    uint32_t	nBlocks;
+    uint32_t	nEntries;
+    uint32_t	nNames;
+    uint32_t	namesSize;
+};
+
+struct STiaBlock {
+    uint32_t	offset;		///< From the start of the file
+    uint32_t	csize;
+    uint32_t	usize;
+};
+
+struct STiaEntry {
+    uint64_t	fingerprint;
+    uint32_t	block;
+    uint32_t	offset;		///< In the uncompressed block
+    uint32_t	size;
+    uint32_t	reserved;
+};
+
+struct STiaName {
+    uint32_t	name;		///< Offset in names
+    uint32_t	entry;
+};
+
+/// Reads all of the file at path. Returns NULL with errno 0 if it is not terminfo.
+static char* ReadEntryFile (const char* path, size_t* psize)
+{
+    char* data = ReadWholeFile (path, psize);
+    if (data && (*psize < sizeof(struct STerminfoHeader) || !IsTerminfoHeader ((const struct STerminfoHeader*) data))) {
+	Free (data);
+	data = NULL;
+	errno = 0;
+    }
+    return data;
+}
+
+/// Names are sorted for binary search in the archive
+static const char* _packNames = NULL;
+static int ComparePackNames (const void* a, const void* b)
+{
+    const struct STiaName *na = (const struct STiaName*) a, *nb = (const struct STiaName*) b;
+    return strcmp (_packNames + na->name, _packNames + nb->name);
+}
+
+/// Packs the database in dbpath into the archive file tiafile
+static int PackMain (const char* tiafile, const char* dbpath)
+{
+    char** paths;
+    const unsigned n = ListDatabase (dbpath, true, &paths);
+    struct STiaEntry* entries = (struct STiaEntry*) Realloc (NULL, max (n,1) * sizeof(struct STiaEntry));
+    struct STiaName* names = (struct STiaName*) Realloc (NULL, max (n,1) * sizeof(struct STiaName));
+    struct STiaBlock* blocks = NULL;
+    struct SBuffer data = {NULL,0,0}, namePool = {NULL,0,0};
+    unsigned nEntries = 0, nNames = 0, nBlocks = 0, blockStart = 0;
+    size_t inputSize = 0;
+
+    // Entries with the same fingerprint are looked up in an open-addressed index
+    unsigned indexSize = 16;
+    while (indexSize < 2*n)
+	indexSize *= 2;
+    uint32_t* index = (uint32_t*) Realloc (NULL, indexSize * sizeof(uint32_t));
+    memset (index, 0, indexSize * sizeof(uint32_t));
+
+    for (unsigned i = 0; i < n; ++i) {
+	size_t size;
+	char* e = ReadEntryFile (paths[i], &size);
+	if (!e) {
+	    if (errno)
+		perror (paths[i]);
+	    continue;
+	}
+	inputSize += size;
+	const uint64_t fp = Fingerprint (e, size);
+	unsigned slot = fp & (indexSize-1);
+	for (; index[slot]; slot = (slot+1) & (indexSize-1)) {
+	    const struct STiaEntry* o = &entries[index[slot]-1];
+	    if (o->fingerprint == fp && o->size == size && 0 == memcmp (data.p + blocks[o->block].offset + o->offset, e, size))
+		break;
+	}
+	if (!index[slot]) {
+	    if (!nBlocks || data.n - blockStart >= TIA_BLOCK_SIZE) {
+		blocks = (struct STiaBlock*) Realloc (blocks, (nBlocks+1) * sizeof(struct STiaBlock));
+		blocks[nBlocks].offset = blockStart = data.n;	// Uncompressed until written
+		blocks[nBlocks++].usize = 0;
+	    }
+	    struct STiaEntry* ne = &entries[nEntries];
+	    ne->fingerprint = fp;
+	    ne->block = nBlocks-1;
+	    ne->offset = data.n - blockStart;
+	    ne->size = size;
+	    ne->reserved = 0;
+	    BufferAppend (&data, e, size);
+	    blocks[nBlocks-1].usize += size;
+	    index[slot] = ++nEntries;
+	}
+	Free (e);
+	const char* name = strrchr (paths[i], '/')+1;
+	names[nNames].name = namePool.n;
+	names[nNames++].entry = index[slot]-1;
+	BufferAppend (&namePool, name, strlen(name)+1);
+    }
+    Free (index);
+    _packNames = namePool.p;
+    qsort (names, nNames, sizeof(struct STiaName), ComparePackNames);
+    unsigned nUnique = 0;	// Names found in more than one directory are kept once
+    for (unsigned i = 0; i < nNames; ++i)
+	if (!nUnique || 0 != strcmp (namePool.p + names[i].name, namePool.p + names[nUnique-1].name))
+	    names[nUnique++] = names[i];
+    nNames = nUnique;
+
+    // Compress each block, then write the tables and the blocks
+    struct SBuffer packed = {NULL,0,0};
+    const struct STiaHeader h = { TIA_MAGIC, nBlocks, nEntries, nNames, namePool.n };
+    uint32_t offset = sizeof(h) + nBlocks*sizeof(struct STiaBlock) + nEntries*sizeof(struct STiaEntry)
+			+ nNames*sizeof(struct STiaName) + namePool.n;
+    uint8_t* cbuf = NULL;
+    for (unsigned b = 0; b < nBlocks; ++b) {
+	cbuf = (uint8_t*) Realloc (cbuf, LzBound (blocks[b].usize));
+	blocks[b].csize = LzCompress ((const uint8_t*) data.p + blocks[b].offset, blocks[b].usize, cbuf);
+	BufferAppend (&packed, cbuf, blocks[b].csize);
+	blocks[b].offset = offset;
+	offset += blocks[b].csize;
+    }
+    Free (cbuf);
+
+    int rv = EXIT_SUCCESS;
+    FILE* f = fopen (tiafile, "wb");
+    if (!f
+	    || 1 != fwrite (&h, sizeof(h), 1, f)
+	    || nBlocks != fwrite (blocks, sizeof(struct STiaBlock), nBlocks, f)
+	    || nEntries != fwrite (entries, sizeof(struct STiaEntry), nEntries, f)
+	    || nNames != fwrite (names, sizeof(struct STiaName), nNames, f)
+	    || namePool.n != fwrite (namePool.p, 1, namePool.n, f)
+	    || packed.n != fwrite (packed.p, 1, packed.n, f)
+	    || 0 != fclose (f)) {
+	perror (tiafile);
+	rv = EXIT_FAILURE;
+    } else
+	printf ("%u names, %u unique entries in %u blocks, %zu bytes packed into %u\n",
+		nNames, nEntries, nBlocks, inputSize, offset);
+    _packNames = NULL;
+    Free (packed.p);
+    Free (data.p);
+    Free (namePool.p);
+    Free (blocks);
+    Free (names);
+    Free (entries);
+    FreePaths (paths, n);
+    return rv;
+}
+
+/// Reads exactly size bytes at offset of the archive into a new buffer
+static void* ReadArchived (int fd, off_t offset, size_t size)
+{
+    void* p = Realloc (NULL, max (size,1));
+    if ((ssize_t) size != Pread (fd, p, size, offset)) {
+	Free (p);
+	p = NULL;
+	errno = 0;
+    }
+    return p;
+}
+
+/// Looks up the entry named termname in the archive index
+static bool FindArchived (int fd, const struct STiaHeader* h, const char* termname, struct STiaEntry* e)
+{
+    const off_t namesOffset = sizeof(*h) + h->nBlocks*sizeof(struct STiaBlock) + h->nEntries*sizeof(struct STiaEntry);
+    struct STiaName* names = (struct STiaName*) ReadArchived (fd, namesOffset, h->nNames*sizeof(struct STiaName));
+    char* namePool = names ? (char*) ReadArchived (fd, namesOffset + h->nNames*sizeof(struct STiaName), h->namesSize) : NULL;
+    bool found = false;
+    if (namePool && h->namesSize && !namePool[h->namesSize-1]) {
+	unsigned lo = 0, hi = h->nNames;
+	while (lo < hi && !found) {
+	    const unsigned mid = (lo+hi)/2;
+	    const int c = strcmp (termname, namePool + min (names[mid].name, h->namesSize-1));
+	    if (!(found = !c) && c < 0)
+		hi = mid;
+	    else if (!found)
+		lo = mid+1;
+	    else
+		lo = mid;
+	}
+	found = found && names[lo].entry < h->nEntries
+	    && sizeof(*e) == Pread (fd, e, sizeof(*e), sizeof(*h) + h->nBlocks*sizeof(struct STiaBlock) + names[lo].entry*sizeof(*e))
+	    && e->block < h->nBlocks;
+    }
+    Free (namePool);
+    Free (names);
+    return found;
+}
+
+/// Reads and decompresses block b of the archive
+static uint8_t* ReadArchivedBlock (int fd, const struct STiaBlock* b)
+{
+    uint8_t* cdata = (uint8_t*) ReadArchived (fd, b->offset, b->csize);
+    if (!cdata)
+	return NULL;
+    uint8_t* udata = (uint8_t*) Realloc (NULL, max (b->usize,1));
+    if (!LzDecompress (cdata, b->csize, udata, b->usize)) {
+	Free (udata);
+	udata = NULL;
+	errno = 0;
+    }
+    Free (cdata);
+    return udata;
+}
+
+/// Extracts the entry for termname from the archive into a new buffer,
+/// returning it, or NULL with errno 0 if not found. Only the index and
+/// the block containing the entry are read.
+static uint8_t* ExtractArchived (const char* tiafile, const char* termname, size_t* psize)
+{
+    int fd = open (tiafile, O_RDONLY);
+    CountSyscall (syscall_Open, 0);
+    if (fd < 0)
+	return NULL;
+    struct STiaHeader h;
+    struct STiaEntry e;
+    struct STiaBlock b;
+    uint8_t* udata = NULL;
+    uint8_t* entry = NULL;
+    errno = 0;
+    if (sizeof(h) == Pread (fd, &h, sizeof(h), 0) && h.magic == TIA_MAGIC
+	    && FindArchived (fd, &h, termname, &e)
+	    && sizeof(b) == Pread (fd, &b, sizeof(b), sizeof(h) + e.block*sizeof(b))
+	    && e.offset <= b.usize && e.size <= b.usize - e.offset
+	    && (udata = ReadArchivedBlock (fd, &b))
+	    && Fingerprint (udata+e.offset, e.size) == e.fingerprint) {
+	entry = (uint8_t*) memcpy (Realloc (NULL, e.size), udata+e.offset, e.size);
+	*psize = e.size;
+    }
+    const int lerrno = errno;
+    Free (udata);
+    close (fd);
+    CountSyscall (syscall_Close, 0);
+    errno = lerrno;
+    return entry;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Entry diffs
+
+/// Appends a value as PrintValue prints it, or - if it is absent
+static void BufferAppendValue (struct SBuffer* b, const struct SValue* v)
+{
+    if (!v || (v->type == type_String ? !v->string : v->number < 0))
+	BufferAppend (b, "-", 1);
+    else if (v->type == type_Boolean)
+	BufferAppendStr (b, v->number == 1 ? "true" : "false");
+    else if (v->type == type_Number)
+	BufferAppendNumber (b, v->number);
+    else {
+	for (unsigned i = 0; i < v->slen; ++i) {
+	    const unsigned char c = v->string[i];
+	    char ebuf [8];
+	    if (c < ' ')
+		BufferAppend (b, ebuf, snprintf (ebuf, sizeof(ebuf), "^%c", 'A'-1+c));
+	    else if (c > '~')
+		BufferAppend (b, ebuf, snprintf (ebuf, sizeof(ebuf), "\\%o", c));
+	    else
+		BufferAppend (b, &c, 1);
+	}
+    }
+}
+
+/// Entries changed, by value name
+struct SChangeTally {
+    struct SStringTable	names;
+    unsigned*		count;
+    unsigned		capacity;
+};
+
+static void TallyChange (struct SChangeTally* t, const char* name)
+{
+    const unsigned id = InternString (&t->names, name);
+    if (id >= t->capacity) {
+	const unsigned oldcap = t->capacity;
+	t->capacity = t->names.capacity;
+	t->count = (unsigned*) Realloc (t->count, t->capacity * sizeof(unsigned));
+	memset (&t->count[oldcap], 0, (t->capacity-oldcap) * sizeof(unsigned));
+    }
+    ++t->count[id];
+}
+
+static void AppendValueChange (struct SBuffer* o, struct SChangeTally* t, const char* name, const struct SValue* av, const struct SValue* bv)
+{
+    BufferAppendStr (o, "    ");
+    BufferAppendStr (o, name);
+    BufferAppendStr (o, ": ");
+    BufferAppendValue (o, av);
+    BufferAppendStr (o, " -> ");
+    BufferAppendValue (o, bv);
+    BufferAppend (o, "\n", 1);
+    if (t)
+	TallyChange (t, name);
+}
+
+/// Appends the names and values that differ between a and b to o, one
+/// per line as "    name: old -> new", and counts them in t if given.
+/// Extended values are matched by name.
+static unsigned FormatEntryDiff (struct SBuffer* o, struct SChangeTally* t, const struct STerminfo* a, const struct STerminfo* b)
+{
+    const unsigned nRows = TerminfoRows (b);
+    uint8_t* changed = (uint8_t*) Realloc (NULL, (nRows+7)/8);
+    unsigned nChanged = DiffTerminfo (a, b, changed);
+    if (0 != strcmp (a->name, b->name)) {
+	const struct SValue an = { "names", type_String, -1, a->name, strlen(a->name) },
+			    bn = { "names", type_String, -1, b->name, strlen(b->name) };
+	AppendValueChange (o, t, "names", &an, &bn);
+	++nChanged;
+    }
+    for (unsigned r = 0; r < nRows; ++r) {
+	if (!(changed[r/8] & (1u << (r%8))))
+	    continue;
+	struct SValue av, bv;
+	GetRowValue (b, r, &bv);
+	unsigned ar = r;
+	if (r >= NValues && (ar = FindExtValue (a, bv.name)) != UINT_MAX)
+	    ar += NValues;
+	if (ar != UINT_MAX)
+	    GetRowValue (a, ar, &av);
+	AppendValueChange (o, t, bv.name, ar != UINT_MAX ? &av : NULL, &bv);
+    }
+    Free (changed);
+    // Extended values only in a
+    for (unsigned r = NValues; r < TerminfoRows (a); ++r) {
+	struct SValue av;
+	GetRowValue (a, r, &av);
+	if (FindExtValue (b, av.name) != UINT_MAX)
+	    continue;
+	AppendValueChange (o, t, av.name, &av, NULL);
+	++nChanged;
+    }
+    return nChanged;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ History store
+//
+// Snapshots of a database are kept in a content-addressed store:
+//   objects/xx/yyyyyyyyyyyyyy	entry or manifest, named by its fingerprint
+//   log			one "time manifest dbdir" line per snapshot
+// A manifest lists the "path fingerprint" of each entry, sorted by path,
+// so snapshotting again stores only the entries that changed.
+
+static void ObjectPath (const char* store, uint64_t fp, char* path, size_t pathsz)
+{
+    snprintf (path, pathsz, "%s/objects/%02x/%014llx", store, (unsigned)(fp >> 56), (unsigned long long)(fp & UINT64_C(0xffffffffffffff)));
+}
+
+/// Stores data as an object, unless already there. Returns 1 if stored, 0 if present,
+/// -1 on error, with errno 0 if a different object has the same fingerprint.
+static int StoreObject (const char* store, const void* data, size_t size, uint64_t* pfp)
+{
+    char path [PATH_MAX], tmppath [PATH_MAX+16];
+    ObjectPath (store, *pfp = Fingerprint (data, size), path, sizeof(path));
+    struct stat st;
+    if (0 == stat (path, &st)) {
+	// The fingerprint is not collision-resistant, so the bytes are compared
+	size_t osize = 0;
+	char* odata = ReadWholeFile (path, &osize);
+	if (!odata)
+	    return -1;
+	const bool same = (osize == size && 0 == memcmp (odata, data, size));
+	Free (odata);
+	if (same)
+	    return 0;
+	errno = 0;
+	return -1;
+    }
+    snprintf (tmppath, sizeof(tmppath), "%s", path);
+    *strrchr (tmppath, '/') = 0;
+    if (0 > mkdir (tmppath, 0755) && errno != EEXIST)
+	return -1;
+    // Written under a temporary name and renamed, so objects are never partial
+    snprintf (tmppath, sizeof(tmppath), "%s.%d", path, (int) getpid());
+    int fd = open (tmppath, O_WRONLY| O_CREAT| O_TRUNC, 0644);
+    CountSyscall (syscall_Open, 0);
+    if (fd < 0)
+	return -1;
+    const bool ok = ((ssize_t) size == write (fd, data, size));
+    close (fd);
+    CountSyscall (syscall_Close, 0);
+    if (!ok || 0 > rename (tmppath, path)) {
+	unlink (tmppath);
+	return -1;
+    }
+    return 1;
+}
+
+/// Stores the entries of dbpath and a manifest of them, and logs the snapshot
+static int SnapshotMain (const char* store, const char* dbpath)
+{
+    char path [PATH_MAX];
+    snprintf (path, sizeof(path), "%s/objects", store);
+    if ((0 > mkdir (store, 0755) && errno != EEXIST) || (0 > mkdir (path, 0755) && errno != EEXIST)) {
+	perror (path);
+	return EXIT_FAILURE;
+    }
+    char** paths;
+    const unsigned n = ListDatabase (dbpath, true, &paths);
+    const size_t dblen = strlen (dbpath);
+    struct SBuffer manifest = {NULL,0,0};
+    unsigned nEntries = 0, nStored = 0;
+    int rv = EXIT_SUCCESS;
+    for (unsigned i = 0; i < n && rv == EXIT_SUCCESS; ++i) {
+	size_t size;
+	char* e = ReadEntryFile (paths[i], &size);
+	if (!e) {
+	    if (errno)
+		perror (paths[i]);
+	    continue;
+	}
+	uint64_t fp;
+	const int stored = StoreObject (store, e, size, &fp);
+	Free (e);
+	if (stored < 0) {
+	    if (errno)
+		perror (store);
+	    else
+		printf ("Error: %s has a different object %016llx\n", store, (unsigned long long) fp);
+	    rv = EXIT_FAILURE;
+	}
+	nStored += (stored > 0);
+	++nEntries;
+	char line [PATH_MAX+32];
+	BufferAppend (&manifest, line, snprintf (line, sizeof(line), "%s %016llx\n", paths[i]+dblen+1, (unsigned long long) fp));
+    }
+    FreePaths (paths, n);
+    uint64_t mfp = 0;
+    if (rv == EXIT_SUCCESS && 0 > StoreObject (store, manifest.p, manifest.n, &mfp)) {
+	if (errno)
+	    perror (store);
+	else
+	    printf ("Error: %s has a different object %016llx\n", store, (unsigned long long) mfp);
+	rv = EXIT_FAILURE;
+    }
+    Free (manifest.p);
+    if (rv != EXIT_SUCCESS)
+	return rv;
+    snprintf (path, sizeof(path), "%s/log", store);
+    FILE* f = fopen (path, "a");
+    if (f) {
+	fprintf (f, "%lld %016llx %s\n", (long long) time (NULL), (unsigned long long) mfp, dbpath);
+	fclose (f);
+    }
+    printf ("%016llx: %u entries, %u new objects\n", (unsigned long long) mfp, nEntries, nStored);
+    return EXIT_SUCCESS;
+}
+
+/// A manifest, split into lines of "path fingerprint"
+struct SManifest {
+    char*	data;
+    char**	path;
+    uint64_t*	fp;
+    unsigned	n;
+};
+
+static bool LoadManifest (const char* store, const char* id, struct SManifest* m)
+{
+    memset (m, 0, sizeof(*m));
+    char path [PATH_MAX];
+    ObjectPath (store, strtoull (id, NULL, 16), path, sizeof(path));
+    size_t size;
+    if (!(m->data = ReadWholeFile (path, &size))) {
+	perror (path);
+	return false;
+    }
+    unsigned capacity = 0;
+    for (char *l = m->data, *eol; *l; l = eol+1) {
+	if (!(eol = strchr (l, '\n')))
+	    break;
+	*eol = 0;
+	char* sp = strrchr (l, ' ');
+	if (!sp)
+	    continue;
+	*sp = 0;
+	if (m->n >= capacity) {
+	    capacity = 2*capacity + 256;
+	    m->path = (char**) Realloc (m->path, capacity * sizeof(char*));
+	    m->fp = (uint64_t*) Realloc (m->fp, capacity * sizeof(uint64_t));
+	}
+	m->path[m->n] = l;
+	m->fp[m->n++] = strtoull (sp+1, NULL, 16);
+    }
+    return true;
+}
+
+static void FreeManifest (struct SManifest* m)
+{
+    Free (m->data);
+    Free (m->path);
+    Free (m->fp);
+    memset (m, 0, sizeof(*m));
+}
+
+/// Prints the capability differences between two stored entries
+static void DiffObjects (const char* store, uint64_t afp, uint64_t bfp)
+{
+    char apath [PATH_MAX], bpath [PATH_MAX];
+    ObjectPath (store, afp, apath, sizeof(apath));
+    ObjectPath (store, bfp, bpath, sizeof(bpath));
+    struct STerminfo* a = AcquireTerminfo (apath);
+    struct STerminfo* b = AcquireTerminfo (bpath);
+    if (a && b) {
+	struct SBuffer o = {NULL,0,0};
+	FormatEntryDiff (&o, NULL, a, b);
+	fwrite (o.p, 1, o.n, stdout);
+	Free (o.p);
+    } else
+	puts ("    (object missing or damaged)");
+    ReleaseTerminfo (b);
+    ReleaseTerminfo (a);
+}
+
+/// Compares two snapshots by merging their manifests. Only entries whose
+/// fingerprints differ are loaded, to print their changed values.
+static int DiffSnapshotsMain (const char* store, const char* aid, const char* bid)
+{
+    struct SManifest a, b;
+    if (!LoadManifest (store, aid, &a))
+	return EXIT_FAILURE;
+    if (!LoadManifest (store, bid, &b)) {
+	FreeManifest (&a);
+	return EXIT_FAILURE;
+    }
+    unsigned nChanged = 0;
+    for (unsigned i = 0, j = 0; i < a.n || j < b.n;) {
+	const int c = i >= a.n ? 1 : j >= b.n ? -1 : strcmp (a.path[i], b.path[j]);
+	if (c < 0)
+	    printf ("%s: removed\n", a.path[i++]);
+	else if (c > 0)
+	    printf ("%s: added\n", b.path[j++]);
+	else if (a.fp[i++] != b.fp[j++]) {
+	    printf ("%s: changed\n", b.path[j-1]);
+	    DiffObjects (store, a.fp[i-1], b.fp[j-1]);
+	} else
+	    continue;
+	++nChanged;
+    }
+    printf ("%u of %u entries differ\n", nChanged, max (a.n, b.n));
+    FreeManifest (&b);
+    FreeManifest (&a);
+    return EXIT_SUCCESS;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Tree diffs
+
+enum EPairState {
+    pair_Identical,
+    pair_Changed,
+    pair_Added,
+    pair_Removed,
+    pair_Unreadable
+};
+
+/// Two databases, with entries matched by path
+struct STreeDiff {
+    char**		apath;
+    char**		bpath;
+    unsigned		alen;		///< Of the database path prefix
+    unsigned		blen;
+    unsigned*		ai;		///< Index of each pair in apath, UINT_MAX if only in b
+    unsigned*		bi;
+    uint8_t*		state;		///< EPairState of each pair
+    struct SBuffer*	out;		///< Change report of each pair
+    struct STerminfo	ti [MAX_WORKERS][2];
+    struct SChangeTally	tally [MAX_WORKERS];
+};
+
+static void DiffTreePair (void* ctx, unsigned worker, unsigned i)
+{
+    struct STreeDiff* d = (struct STreeDiff*) ctx;
+    if (d->ai[i] == UINT_MAX)
+	d->state[i] = pair_Added;
+    else if (d->bi[i] == UINT_MAX)
+	d->state[i] = pair_Removed;
+    else {
+	// Each file is read once; identical bytes need no parsing
+	struct STerminfo* ti = d->ti[worker];
+	size_t asize = 0, bsize = 0;
+	char* ad = ReadWholeFile (d->apath[d->ai[i]], &asize);
+	char* bd = ad ? ReadWholeFile (d->bpath[d->bi[i]], &bsize) : NULL;
+	if (!bd)
+	    d->state[i] = pair_Unreadable;
+	else if (asize == bsize && 0 == memcmp (ad, bd, asize))
+	    d->state[i] = pair_Identical;
+	else if (!LoadTerminfoBytes (ad, asize, &ti[0]) || !ValidTerminfo (&ti[0])
+		|| !LoadTerminfoBytes (bd, bsize, &ti[1]) || !ValidTerminfo (&ti[1]))
+	    d->state[i] = pair_Unreadable;
+	else
+	    d->state[i] = FormatEntryDiff (&d->out[i], &d->tally[worker], &ti[0], &ti[1]) ? pair_Changed : pair_Identical;
+	Free (bd);
+	Free (ad);
+    }
+}
+
+struct SChangeCount {
+    const char*	name;
+    unsigned	count;
+};
+
+static int CompareChangeCounts (const void* a, const void* b)
+{
+    const struct SChangeCount *ca = (const struct SChangeCount*) a, *cb = (const struct SChangeCount*) b;
+    if (ca->count != cb->count)
+	return ca->count > cb->count ? -1 : 1;
+    return strcmp (ca->name, cb->name);
+}
+
+/// Compares the databases in adir and bdir, printing the changes in
+/// each differing entry followed by the number of entries in which each
+/// value changed. Identical files are recognized by their bytes without
+/// parsing; the rest are compared on all cores.
+static int DiffTreeMain (const char* adir, const char* bdir)
+{
+    struct STreeDiff* d = (struct STreeDiff*) Realloc (NULL, sizeof(struct STreeDiff));
+    memset (d, 0, sizeof(*d));
+    const unsigned an = ListDatabase (adir, true, &d->apath), bn = ListDatabase (bdir, true, &d->bpath);
+    d->alen = strlen (adir) + 1;
+    d->blen = strlen (bdir) + 1;
+    d->ai = (unsigned*) Realloc (NULL, (an+bn+1) * sizeof(unsigned));
+    d->bi = (unsigned*) Realloc (NULL, (an+bn+1) * sizeof(unsigned));
+    unsigned n = 0;
+    for (unsigned i = 0, j = 0; i < an || j < bn; ++n) {
+	const int c = i >= an ? 1 : j >= bn ? -1 : strcmp (d->apath[i]+d->alen, d->bpath[j]+d->blen);
+	d->ai[n] = c <= 0 ? i++ : UINT_MAX;
+	d->bi[n] = c >= 0 ? j++ : UINT_MAX;
+    }
+    d->state = (uint8_t*) Realloc (NULL, n+1);
+    d->out = (struct SBuffer*) Realloc (NULL, (n+1) * sizeof(struct SBuffer));
+    memset (d->out, 0, (n+1) * sizeof(struct SBuffer));
+    const unsigned nWorkers = NumWorkers();
+    RunWorkers (n, nWorkers, DiffTreePair, d);
+
+    static const char c_StateNames[][16] = { "identical", "changed", "added", "removed", "unreadable" };
+    unsigned nState [5] = {0};
+    for (unsigned i = 0; i < n; ++i) {
+	++nState[d->state[i]];
+	if (d->state[i] != pair_Identical)
+	    printf ("%s: %s\n", d->ai[i] == UINT_MAX ? d->bpath[d->bi[i]]+d->blen : d->apath[d->ai[i]]+d->alen, c_StateNames[d->state[i]]);
+	fwrite (d->out[i].p, 1, d->out[i].n, stdout);
+	Free (d->out[i].p);
+    }
+    printf ("%u entries: %u identical, %u changed, %u added, %u removed, %u unreadable\n", n,
+	    nState[pair_Identical], nState[pair_Changed], nState[pair_Added], nState[pair_Removed], nState[pair_Unreadable]);
+
+    // Merge the worker tallies into one count per value name
+    struct SStringTable names;
+    memset (&names, 0, sizeof(names));
+    struct SChangeCount* counts = NULL;
+    unsigned nCounts = 0;
+    for (unsigned w = 0; w < nWorkers; ++w) {
+	const struct SChangeTally* t = &d->tally[w];
+	for (unsigned id = 0; id < t->names.n; ++id) {
+	    const unsigned gid = InternString (&names, InternedString (&t->names, id));
+	    if (gid >= nCounts) {
+		counts = (struct SChangeCount*) Realloc (counts, (nCounts = gid+1) * sizeof(struct SChangeCount));
+		counts[gid].count = 0;
+	    }
+	    counts[gid].count += t->count[id];
+	}
+    }
+    for (unsigned i = 0; i < nCounts; ++i)
+	counts[i].name = InternedString (&names, i);
+    qsort (counts, nCounts, sizeof(struct SChangeCount), CompareChangeCounts);
+    if (nCounts)
+	puts ("\nEntries changed, by value:");
+    for (unsigned i = 0; i < nCounts; ++i)
+	printf ("%8u %s\n", counts[i].count, counts[i].name);
+
+    Free (counts);
+    FreeStringTable (&names);
+    for (unsigned w = 0; w < nWorkers; ++w) {
+	FreeTerminfo (&d->ti[w][0]);
+	FreeTerminfo (&d->ti[w][1]);
+	FreeStringTable (&d->tally[w].names);
+	Free (d->tally[w].count);
+    }
+    Free (d->out);
+    Free (d->state);
+    Free (d->bi);
+    Free (d->ai);
+    FreePaths (d->bpath, bn);
+    FreePaths (d->apath, an);
+    Free (d);
+    return nState[pair_Identical] == n ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Distance matrix
+//
+// Each entry is reduced to a row of value ids, one per standard value
+// and extended value name in the database, with equal values sharing an
+// id and 0 for undefined. The distance between two entries, the number
+// of values defined in only one plus those defined in both but
+// different, is then the number of positions where their rows differ.
+
+enum {
+    MATRIX_TILE = 32,		///< Entries per side of a tile of the matrix
+    MATRIX_MAGIC = 0x014d4954	///< "TIM\1"
+};
+
+/// Values of one entry, with ids local to the worker that loaded it
+struct SEntryValues {
+    uint32_t*	slot;		///< Row, or NValues + extended name id
+    uint32_t*	value;
+    unsigned	n;
+};
+
+struct SMatrixWorker {
+    struct SStringTable	extNames;
+    struct SStringTable	values;
+    struct SBuffer	key;
+};
+
+struct SMatrix {
+    struct SMatrixWorker	w [MAX_WORKERS];
+    struct SEntryValues*	e;
+    uint8_t*			worker;	///< That loaded each entry
+    uint32_t*			ids;	///< n rows of width ids
+    unsigned			width;	///< Multiple of 4
+    unsigned			n;
+    uint16_t*			dist;	///< n x n
+};
+
+static void MatrixEntry (void* ctx, unsigned worker, unsigned i, const char* path UNUSED, const struct STerminfo* ti)
+{
+    struct SMatrix* m = (struct SMatrix*) ctx;
+    struct SMatrixWorker* w = &m->w[worker];
+    struct SEntryValues* e = &m->e[i];
+    m->worker[i] = worker;
+    if (!ti)
+	return;
+    const unsigned nRows = TerminfoRows (ti);
+    e->slot = (uint32_t*) Realloc (NULL, nRows * sizeof(uint32_t));
+    e->value = (uint32_t*) Realloc (NULL, nRows * sizeof(uint32_t));
+    for (unsigned r = 0; r < nRows; ++r) {
+	struct SValue v;
+	GetRowValue (ti, r, &v);
+	if (!IsDefinedValue (&v) || (v.type == type_Boolean && !v.number))
+	    continue;
+	// Values are interned with their type, as "b", "n42", or "s\33[H"
+	w->key.n = 0;
+	BufferAppend (&w->key, &"bns"[v.type], 1);
+	if (v.type == type_Number)
+	    BufferAppendNumber (&w->key, v.number);
+	else if (v.type == type_String)
+	    BufferAppend (&w->key, v.string, v.slen);
+	BufferAppend (&w->key, "", 1);
+	e->slot[e->n] = r < NValues ? r : NValues + InternString (&w->extNames, v.name);
+	e->value[e->n++] = InternString (&w->values, w->key.p);
+    }
+}
+
+/// Number of positions where rows a and b of n ids differ
+static unsigned RowDistance (const uint32_t* a, const uint32_t* b, unsigned n)
+{
+#if __SSE2__
+    __m128i neq = _mm_setzero_si128();
+    for (unsigned i = 0; i < n; i += 4)	// Equal lanes are -1, so this counts them negatively
+	neq = _mm_add_epi32 (neq, _mm_cmpeq_epi32 (_mm_loadu_si128 ((const __m128i*)(a+i)), _mm_loadu_si128 ((const __m128i*)(b+i))));
+    neq = _mm_add_epi32 (neq, _mm_shuffle_epi32 (neq, _MM_SHUFFLE(1,0,3,2)));
+    neq = _mm_add_epi32 (neq, _mm_shuffle_epi32 (neq, _MM_SHUFFLE(2,3,0,1)));
+    return n + _mm_cvtsi128_si32 (neq);
+#else
+    unsigned d = 0;
+    for (unsigned i = 0; i < n; ++i)
+	d += (a[i] != b[i]);
+    return d;
+#endif
+}
+
+/// Fills one tile of the matrix. Tiles are numbered along the rows of
+/// the upper triangle, so that the rows of both blocks stay in cache.
+static void MatrixTile (void* ctx, unsigned worker UNUSED, unsigned t)
+{
+    struct SMatrix* m = (struct SMatrix*) ctx;
+    const unsigned nb = (m->n + MATRIX_TILE-1) / MATRIX_TILE;
+    unsigned bi = 0;
+    while (t >= nb-bi)
+	t -= nb - bi++;
+    const unsigned bj = bi + t;
+    for (unsigned i = bi*MATRIX_TILE; i < min ((bi+1)*MATRIX_TILE, m->n); ++i) {
+	for (unsigned j = max (bj*MATRIX_TILE, i+1); j < min ((bj+1)*MATRIX_TILE, m->n); ++j) {
+	    const uint16_t d = RowDistance (m->ids + (size_t) i*m->width, m->ids + (size_t) j*m->width, m->width);
+	    m->dist[(size_t) i*m->n + j] = m->dist[(size_t) j*m->n + i] = d;
+	}
+    }
+}
+
+/// Maps each worker's local ids into one global numbering
+static uint32_t* MergeIds (struct SMatrix* m, unsigned nWorkers, bool ext, unsigned* pn)
+{
+    struct SStringTable all;
+    memset (&all, 0, sizeof(all));
+    uint32_t* map [MAX_WORKERS];
+    for (unsigned w = 0; w < nWorkers; ++w) {
+	const struct SStringTable* t = ext ? &m->w[w].extNames : &m->w[w].values;
+	map[w] = (uint32_t*) Realloc (NULL, (t->n+1) * sizeof(uint32_t));
+	for (unsigned id = 0; id < t->n; ++id)
+	    map[w][id] = InternString (&all, InternedString (t, id));
+    }
+    // Flattened as map[w] at offset w*stride, with stride the largest table
+    unsigned stride = 1;
+    for (unsigned w = 0; w < nWorkers; ++w)
+	stride = max (stride, (ext ? m->w[w].extNames.n : m->w[w].values.n));
+    uint32_t* flat = (uint32_t*) Realloc (NULL, (size_t) nWorkers*stride * sizeof(uint32_t));
+    for (unsigned w = 0; w < nWorkers; ++w) {
+	memcpy (flat + (size_t) w*stride, map[w], (ext ? m->w[w].extNames.n : m->w[w].values.n) * sizeof(uint32_t));
+	Free (map[w]);
+    }
+    *pn = stride;
+    m->width = max (m->width, ext ? NValues + all.n : 0);
+    FreeStringTable (&all);
+    return flat;
+}
+
+static unsigned FindRoot (unsigned* parent, unsigned i)
+{
+    while (parent[i] != i)
+	i = parent[i] = parent[parent[i]];
+    return i;
+}
+
+static const char* EntryBaseName (const char* path)
+{
+    return strrchr (path, '/')+1;
+}
+
+/// Prints groups of entries linked by distances up to maxd, largest first
+static void PrintClusters (const struct SMatrix* m, char* const* paths, unsigned maxd)
+{
+    unsigned* parent = (unsigned*) Realloc (NULL, m->n * sizeof(unsigned));
+    for (unsigned i = 0; i < m->n; ++i)
+	parent[i] = i;
+    for (unsigned i = 0; i < m->n; ++i)
+	for (unsigned j = i+1; j < m->n; ++j)
+	    if (m->dist[(size_t) i*m->n + j] <= maxd)
+		parent[FindRoot (parent, j)] = FindRoot (parent, i);
+    unsigned* size = (unsigned*) Realloc (NULL, m->n * sizeof(unsigned));
+    memset (size, 0, m->n * sizeof(unsigned));
+    for (unsigned i = 0; i < m->n; ++i)
+	++size[FindRoot (parent, i)];
+    unsigned nClusters = 0;
+    for (unsigned s = m->n; s > 1; --s) {
+	for (unsigned r = 0; r < m->n; ++r) {
+	    if (size[r] != s || parent[r] != r)
+		continue;
+	    ++nClusters;
+	    printf ("%u entries:", s);
+	    for (unsigned i = 0; i < m->n; ++i)
+		if (FindRoot (parent, i) == r)
+		    printf (" %s", EntryBaseName (paths[i]));
+	    putchar ('\n');
+	}
+    }
+    printf ("%u clusters within distance %u\n", nClusters, maxd);
+    Free (size);
+    Free (parent);
+}
+
+/// Writes the matrix as MATRIX_MAGIC, n, the size of the names, the n
+/// NUL-terminated entry names, and n*n 16-bit distances, row by row.
+static bool WriteMatrix (const struct SMatrix* m, char* const* paths, const char* file)
+{
+    FILE* f = fopen (file, "wb");
+    if (!f)
+	return false;
+    uint32_t namesSize = 0;
+    for (unsigned i = 0; i < m->n; ++i)
+	namesSize += strlen (EntryBaseName (paths[i]))+1;
+    const uint32_t h[3] = { MATRIX_MAGIC, m->n, namesSize };
+    bool ok = (1 == fwrite (h, sizeof(h), 1, f));
+    for (unsigned i = 0; ok && i < m->n; ++i)
+	ok = (0 <= fputs (EntryBaseName (paths[i]), f) && 0 <= fputc (0, f));
+    ok = ok && (size_t) m->n*m->n == fwrite (m->dist, sizeof(uint16_t), (size_t) m->n*m->n, f);
+    return 0 == fclose (f) && ok;
+}
+
+/// Computes the distance between every pair of entries in the database,
+/// and either writes the matrix to file or prints clusters within maxd.
+static int MatrixMain (const char* file, unsigned maxd)
+{
+    const char* dbpath = TerminfoDbPath();
+    char** paths;
+    const unsigned n = ListDatabase (dbpath, false, &paths);
+    const unsigned nWorkers = NumWorkers();
+    struct SMatrix* m = (struct SMatrix*) Realloc (NULL, sizeof(struct SMatrix));
+    memset (m, 0, sizeof(*m));
+    m->n = n;
+    m->e = (struct SEntryValues*) Realloc (NULL, max (n,1) * sizeof(struct SEntryValues));
+    memset (m->e, 0, max (n,1) * sizeof(struct SEntryValues));
+    m->worker = (uint8_t*) Realloc (NULL, max (n,1));
+    RunScan (dbpath, paths, n, nWorkers, MatrixEntry, m);
+
+    // Build the rows of global ids, 0 being undefined
+    unsigned extStride, valueStride;
+    uint32_t* extMap = MergeIds (m, nWorkers, true, &extStride);
+    uint32_t* valueMap = MergeIds (m, nWorkers, false, &valueStride);
+    m->width = (max (m->width, NValues) + 3) & ~3u;
+    m->ids = (uint32_t*) Realloc (NULL, max ((size_t) n*m->width, 1) * sizeof(uint32_t));
+    memset (m->ids, 0, (size_t) n*m->width * sizeof(uint32_t));
+    for (unsigned i = 0; i < n; ++i) {
+	const struct SEntryValues* e = &m->e[i];
+	uint32_t* row = m->ids + (size_t) i*m->width;
+	for (unsigned k = 0; k < e->n; ++k) {
+	    unsigned slot = e->slot[k];
+	    if (slot >= NValues)
+		slot = NValues + extMap [(size_t) m->worker[i]*extStride + slot-NValues];
+	    row[slot] = valueMap [(size_t) m->worker[i]*valueStride + e->value[k]] + 1;
+	}
+	Free (e->slot);
+	Free (e->value);
+    }
+    Free (valueMap);
+    Free (extMap);
+    for (unsigned w = 0; w < nWorkers; ++w) {
+	FreeStringTable (&m->w[w].extNames);
+	FreeStringTable (&m->w[w].values);
+	Free (m->w[w].key.p);
+    }
+
+    m->dist = (uint16_t*) Realloc (NULL, max ((size_t) n*n, 1) * sizeof(uint16_t));
+    memset (m->dist, 0, (size_t) n*n * sizeof(uint16_t));
+    const unsigned nb = (n + MATRIX_TILE-1) / MATRIX_TILE;
+    RunWorkers (nb*(nb+1)/2, nWorkers, MatrixTile, m);
+
+    int rv = EXIT_SUCCESS;
+    if (!file)
+	PrintClusters (m, paths, maxd);
+    else if (!WriteMatrix (m, paths, file)) {
+	perror (file);
+	rv = EXIT_FAILURE;
+    }
+    Free (m->dist);
+    Free (m->ids);
+    Free (m->worker);
+    Free (m->e);
+    Free (m);
+    FreePaths (paths, n);
+    return rv;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Value prevalence
+//
+// How many entries of the database define each value, and how many share
+// each of its values, is counted once and cached in
+//   $XDG_CACHE_HOME/tiedit/prevalence-<fingerprint of the database path>
+// as a SPrevalenceHeader followed by two arrays of SPrevalenceCount, one
+// keyed by value name, the other by name and value, each sorted by key,
+// so lookups are binary searches in the mapped file. The header has a
+// stamp of the path, inode, size, and mtime of every entry file, so the
+// census is retaken when any entry is added, removed, or rewritten, even
+// in place. Checking it costs a listing of the database and one stat per
+// entry, about 3k on a full database, each time the cache is opened;
+// a few milliseconds when the inodes are already cached.
+
+enum { PREVALENCE_MAGIC = 0x01504954 };	///< "TIP\1"
+
+struct SPrevalenceHeader {
+    uint32_t	magic;
+    uint32_t	nEntries;
+    uint32_t	nNames;
+    uint32_t	nValues;
+    uint64_t	stamp;
+};
+
+struct SPrevalenceCount {
+    uint64_t	key;
+    uint32_t	count;
+    uint32_t	reserved;
+};
+
+/// Keys of the defined values in the entries loaded by one worker
+struct SPrevalenceWorker {
+    struct SBuffer	names;
+    struct SBuffer	values;
+    struct SBuffer	key;
+};
+
+/// The census of the database, mapped from the cache file
+static struct {
+    const struct SPrevalenceHeader* h;
+    size_t		size;
+    struct SBuffer	key;
+    bool		shown;	///< As a column of the entry view
+} _prevalence;
+
+/// Fingerprints v's name, and its name and value, keyed with the type as
+/// in MatrixEntry. Returns whether v is defined.
+static bool PrevalenceKeys (const struct SValue* v, struct SBuffer* k, uint64_t* pname, uint64_t* pvalue)
+{
+    k->n = 0;
+    BufferAppend (k, v->name, strlen(v->name)+1);
+    *pname = Fingerprint (k->p, k->n);
+    if (!IsDefinedValue (v) || (v->type == type_Boolean && !v->number))
+	return false;
+    BufferAppend (k, &"bns"[v->type], 1);
+    if (v->type == type_Number)
+	BufferAppendNumber (k, v->number);
+    else if (v->type == type_String)
+	BufferAppend (k, v->string, v->slen);
+    *pvalue = Fingerprint (k->p, k->n);
+    return true;
+}
+
+static void PrevalenceEntry (void* ctx, unsigned worker, unsigned i UNUSED, const char* path UNUSED, const struct STerminfo* ti)
+{
+    struct SPrevalenceWorker* w = &((struct SPrevalenceWorker*) ctx)[worker];
+    if (!ti)
+	return;
+    for (unsigned r = 0; r < TerminfoRows (ti); ++r) {
+	struct SValue v;
+	GetRowValue (ti, r, &v);
+	uint64_t name, value;
+	if (PrevalenceKeys (&v, &w->key, &name, &value)) {
+	    BufferAppend (&w->names, &name, sizeof(name));
+	    BufferAppend (&w->values, &value, sizeof(value));
+	}
+    }
+}
+
+static int CompareKeys (const void* a, const void* b)
+{
+    const uint64_t ka = *(const uint64_t*) a, kb = *(const uint64_t*) b;
+    return ka < kb ? -1 : ka > kb;
+}
+
+/// Appends to out a SPrevalenceCount for each distinct key collected by
+/// the workers, in key order. Returns the number appended.
+static unsigned AppendKeyCounts (struct SBuffer* out, const struct SPrevalenceWorker* w, unsigned nWorkers, bool values)
+{
+    struct SBuffer all = {NULL,0,0};
+    for (unsigned wi = 0; wi < nWorkers; ++wi) {
+	const struct SBuffer* k = values ? &w[wi].values : &w[wi].names;
+	BufferAppend (&all, k->p, k->n);
+    }
+    uint64_t* keys = (uint64_t*) all.p;
+    const unsigned n = all.n / sizeof(uint64_t);
+    if (n)
+	qsort (keys, n, sizeof(uint64_t), CompareKeys);
+    unsigned nCounts = 0;
+    for (unsigned i = 0, j; i < n; i = j, ++nCounts) {
+	for (j = i+1; j < n && keys[j] == keys[i]; ++j) {}
+	const struct SPrevalenceCount c = { keys[i], j-i, 0 };
+	BufferAppend (out, &c, sizeof(c));
+    }
+    Free (all.p);
+    return nCounts;
+}
+
+/// Scans dbpath on all workers and returns its census in b
+static void TakeCensus (const char* dbpath, uint64_t stamp, struct SBuffer* b)
+{
+    char** paths;
+    const unsigned n = ListDatabase (dbpath, false, &paths);
+    const unsigned nWorkers = NumWorkers();
+    struct SPrevalenceWorker* w = (struct SPrevalenceWorker*) Realloc (NULL, nWorkers * sizeof(struct SPrevalenceWorker));
+    memset (w, 0, nWorkers * sizeof(struct SPrevalenceWorker));
+    RunScan (dbpath, paths, n, nWorkers, PrevalenceEntry, w);
+    FreePaths (paths, n);
+    struct SPrevalenceHeader h = { PREVALENCE_MAGIC, n, 0, 0, stamp };
+    BufferAppend (b, &h, sizeof(h));
+    h.nNames = AppendKeyCounts (b, w, nWorkers, false);
+    h.nValues = AppendKeyCounts (b, w, nWorkers, true);
+    memcpy (b->p, &h, sizeof(h));
+    for (unsigned wi = 0; wi < nWorkers; ++wi) {
+	Free (w[wi].names.p);
+	Free (w[wi].values.p);
+	Free (w[wi].key.p);
+    }
+    Free (w);
+}
+
+/// Fingerprint of the path, inode, size, and modification time of each
+/// entry in dbpath. Takes one stat per entry.
+static uint64_t DatabaseStamp (const char* dbpath)
+{
+    struct SBuffer b = {NULL,0,0};
+    BufferAppendStr (&b, dbpath);
+    char** paths;
+    const unsigned n = ListDatabase (dbpath, true, &paths);
+    for (unsigned i = 0; i < n; ++i) {
+	BufferAppendStr (&b, paths[i]);
+	struct stat st;
+	if (0 == stat (paths[i], &st)) {
+	    BufferAppend (&b, &st.st_ino, sizeof(st.st_ino));
+	    BufferAppend (&b, &st.st_size, sizeof(st.st_size));
+	    BufferAppend (&b, &st.st_mtim, sizeof(st.st_mtim));
+	}
+    }
+    FreePaths (paths, n);
+    const uint64_t stamp = Fingerprint (b.p, b.n);
+    Free (b.p);
+    return stamp;
+}
+
+/// Gets the cache file path for the census of dbpath, creating its directory.
+/// Returns false if there is no cache directory.
+static bool PrevalenceCachePath (const char* dbpath, char* path, size_t pathsz)
+{
+    const char* xdg = getenv ("XDG_CACHE_HOME");
+    const char* home = getenv ("HOME");
+    char dir [PATH_MAX];
+    if (xdg && xdg[0])
+	snprintf (dir, sizeof(dir), "%s", xdg);
+    else if (home && home[0])
+	snprintf (dir, sizeof(dir), "%s/.cache", home);
+    else
+	return false;
+    if (0 > mkdir (dir, 0755) && errno != EEXIST)
+	return false;
+    const size_t dirlen = strlen (dir);
+    snprintf (dir+dirlen, sizeof(dir)-dirlen, "/tiedit");
+    if (0 > mkdir (dir, 0755) && errno != EEXIST)
+	return false;
+    snprintf (path, pathsz, "%s/prevalence-%016llx", dir, (unsigned long long) Fingerprint (dbpath, strlen(dbpath)));
+    return true;
+}
+
+/// Maps the census in fd, if it is valid and of the database with the given stamp
+static bool MapPrevalence (int fd, uint64_t stamp)
+{
+    struct stat st;
+    void* p = MAP_FAILED;
+    if (0 == fstat (fd, &st) && (size_t) st.st_size >= sizeof(struct SPrevalenceHeader)) {
+	p = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	CountSyscall (syscall_Mmap, 0);
+    }
+    if (p == MAP_FAILED)
+	return false;
+    const struct SPrevalenceHeader* h = (const struct SPrevalenceHeader*) p;
+    if (h->magic != PREVALENCE_MAGIC || h->stamp != stamp
+	    || (size_t) st.st_size != sizeof(*h) + ((size_t) h->nNames + h->nValues) * sizeof(struct SPrevalenceCount)) {
+	munmap (p, st.st_size);
+	return false;
+    }
+    _prevalence.h = h;
+    _prevalence.size = st.st_size;
+    return true;
+}
+
+/// Maps the cached census of the database, taking it first if the cache
+/// is missing or stale. Without a cache directory, the census is written
+/// to an anonymous file and lasts only for this session.
+static bool LoadPrevalence (void)
+{
+    if (_prevalence.h)
+	return true;
+    const char* dbpath = TerminfoDbPath();
+    const uint64_t stamp = DatabaseStamp (dbpath);
+    char path [PATH_MAX], tmppath [PATH_MAX+16];
+    const bool cached = PrevalenceCachePath (dbpath, path, sizeof(path));
+    int fd = -1;
+    if (cached) {
+	fd = open (path, O_RDONLY);
+	CountSyscall (syscall_Open, 0);
+    }
+    if (fd >= 0) {
+	const bool ok = MapPrevalence (fd, stamp);
+	close (fd);
+	CountSyscall (syscall_Close, 0);
+	if (ok)
+	    return true;
+    }
+    struct SBuffer b = {NULL,0,0};
+    TakeCensus (dbpath, stamp, &b);
+    // Written under a temporary name and renamed, so other sessions never map a partial census
+    fd = -1;
+    if (cached) {
+	snprintf (tmppath, sizeof(tmppath), "%s.%d", path, (int) getpid());
+	if (0 <= (fd = open (tmppath, O_RDWR| O_CREAT| O_TRUNC, 0644))
+		&& ((ssize_t) b.n != write (fd, b.p, b.n) || 0 > rename (tmppath, path))) {
+	    close (fd);
+	    unlink (tmppath);
+	    fd = -1;
+	}
+	CountSyscall (syscall_Open, 0);
+    }
+    if (fd < 0 && 0 <= (fd = memfd_create ("prevalence", 0)) && (ssize_t) b.n != write (fd, b.p, b.n)) {
+	close (fd);
+	fd = -1;
+    }
+    Free (b.p);
+    if (fd < 0)
+	return false;
+    const bool ok = MapPrevalence (fd, stamp);
+    close (fd);
+    CountSyscall (syscall_Close, 0);
+    return ok;
+}
+
+/// Returns the count of key in the n counts sorted by key, or 0
+static unsigned FindKeyCount (const struct SPrevalenceCount* c, unsigned n, uint64_t key)
+{
+    for (unsigned b = 0, e = n; b < e;) {
+	const unsigned m = b + (e-b)/2;
+	if (c[m].key == key)
+	    return c[m].count;
+	else if (c[m].key < key)
+	    b = m+1;
+	else
+	    e = m;
+    }
+    return 0;
+}
+
+/// Gets the number of entries defining v, and, if v is defined, the number
+/// sharing its value. Returns false for an undefined v.
+static bool ValuePrevalence (const struct SValue* v, unsigned* pdefined, unsigned* psame)
+{
+    const struct SPrevalenceCount* names = (const struct SPrevalenceCount*) (_prevalence.h+1);
+    uint64_t name, value;
+    const bool defined = PrevalenceKeys (v, &_prevalence.key, &name, &value);
+    *pdefined = FindKeyCount (names, _prevalence.h->nNames, name);
+    *psame = defined ? FindKeyCount (names + _prevalence.h->nNames, _prevalence.h->nValues, value) : 0;
+    return defined;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Fuzzy finder
+
+/// Returns the index of the first c in s[i,n), or n. May read 15 bytes past n.
+static unsigned FindByte (const char* s, unsigned i, unsigned n, char c)
+{
+#if __SSE2__
+    const __m128i vc = _mm_set1_epi8 (c);
+    for (; i < n; i += 16) {
+	unsigned m = _mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i*)(s+i)), vc));
+	if (m)
+	    return min (i+__builtin_ctz(m), n);
+    }
+    return n;
+#else
+    const char* f = (i < n ? memchr (s+i, c, n-i) : NULL);
+    return f ? (unsigned)(f-s) : n;
+#endif
+}
+
+enum {
+    score_NoMatch	= INT_MIN,
+    score_Match		= 16,
+    score_Boundary	= 8,	///< Match at the start of a name or word
+    score_Consecutive	= 8,
+    score_GapStart	= -3,
+    score_GapExtension	= -1
+};
+
+/// fzf-style score of query q matching key as a subsequence
+static int FuzzyScore (const char* key, unsigned keysz, const char* q, unsigned qlen)
+{
+    // Forward pass finds the earliest end of the match
+    unsigned end = 0;
+    for (unsigned qi = 0; qi < qlen; ++qi, ++end)
+	if ((end = FindByte (key, end, keysz, q[qi])) >= keysz)
+	    return score_NoMatch;
+    // Backward pass from it finds the shortest window
+    unsigned start = end;
+    for (unsigned qi = qlen; qi--;)
+	while (key[--start] != q[qi]) {}
+    int score = 0;
+    bool consecutive = false;
+    for (unsigned i = start, qi = 0; i < end; ++i) {
+	if (key[i] == q[qi]) {
+	    score += score_Match;
+	    const char p = i ? key[i-1] : '|';
+	    if (p == '|' || p == '-' || p == '_' || p == '.' || p == '+')
+		score += score_Boundary * (1+(p == '|'));
+	    if (consecutive)
+		score += score_Consecutive;
+	    consecutive = true;
+	    ++qi;
+	} else {
+	    score += consecutive ? score_GapStart : score_GapExtension;
+	    consecutive = false;
+	}
+    }
+    return score;
+}
+
+static int CompareMatches (const void* a, const void* b)
+{
+    const struct SMatch *ma = (const struct SMatch*) a, *mb = (const struct SMatch*) b;
+    if (ma->score != mb->score)
+	return ma->score > mb->score ? -1 : 1;
+    if (_terms.keySize[ma->term] != _terms.keySize[mb->term])
+	return _terms.keySize[ma->term] < _terms.keySize[mb->term] ? -1 : 1;
+    return ma->term < mb->term ? -1 : ma->term > mb->term;
+}
+
+/// Scores terminals from first on against the query, and reranks all matches
+static void MatchTerms (unsigned first)
+{
+    if (_filter.capacity < _terms.n) {
+	_filter.capacity = _terms.capacity;
+	_filter.match = (struct SMatch*) Realloc (_filter.match, _filter.capacity * sizeof(struct SMatch));
+    }
+    uint64_t qchars = 0;
+    for (unsigned i = 0; i < _filter.qlen; ++i)
+	qchars |= UINT64_C(1) << (_filter.query[i] % 64);
+    for (unsigned t = first; t < _terms.n; ++t) {
+	if ((_terms.keyChars[t] & qchars) != qchars)
+	    continue;
+	const int score = FuzzyScore (_terms.keys+_terms.keyOffset[t], _terms.keySize[t], _filter.query, _filter.qlen);
+	if (score != score_NoMatch)
+	    _filter.match[_filter.n++] = (struct SMatch) { score, t };
+    }
+    qsort (_filter.match, _filter.n, sizeof(struct SMatch), CompareMatches);
+}
+
+/// Ranks all terminals against the query
+static void FilterTerms (void)
+{
+    _filter.n = 0;
+    _terms.topline = _terms.selection = 0;
+    if (_filter.qlen)
+	MatchTerms (0);
+}
+
+/// Ranks terminals from first on, added by the scanner, among the
+/// matches, keeping the selected terminal selected.
+static void FilterNewTerms (unsigned first)
+{
+    const bool selected = (_terms.selection < _filter.n);
+    const unsigned term = selected ? _filter.match[_terms.selection].term : 0, offset = _terms.selection - _terms.topline;
+    MatchTerms (first);
+    if (!selected)
+	return;
+    unsigned p = 0;
+    while (p < _filter.n-1 && _filter.match[p].term != term)
+	++p;
+    _terms.selection = p;
+    _terms.topline = p - min (p, offset);
+}
+
+/// Number of rows in the browser, filtered or not
+static unsigned BrowserRows (void)
+{
+    return _filter.qlen ? _filter.n : _terms.n;
+}
+
+/// Index into _terms of browser row r
+static unsigned BrowserTerm (unsigned r)
+{
+    return _filter.qlen ? _filter.match[r].term : r;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Screen output
+//
+// The UI draws through these. They forward to curses, unless --lite is
+// given. Then curses is never initialized, and cells are drawn into a
+// shadow buffer instead. Each refresh writes only the spans that differ
+// from the last frame, using the terminal's own cup, el, and sgr0, in
+// one writev.
+
+static unsigned ScreenCols (void)
+{
+    return _scr.lite ? _scr.cols : (unsigned) COLS;
+}
+
+static unsigned ScreenLines (void)
+{
+    return _scr.lite ? _scr.lines : (unsigned) LINES;
+}
+
+static void ScreenMove (unsigned y, unsigned x)
+{
+    if (!_scr.lite)
+	move (y, x);
+    _scr.y = y;
+    _scr.x = x;
+}
+
+/// Sets curses attributes a. Without curses, only bold and reverse are kept.
+static void ScreenAttr (unsigned a)
+{
+    if (!_scr.lite)
+	attrset (a);
+    _scr.attr = ((a & A_BOLD) ? attr_Bold : 0)| ((a & A_REVERSE) ? attr_Reverse : 0);
+}
+
+/// Draws up to n characters of s, truncated at the right edge without curses
+static void ScreenAddnstr (const char* s, unsigned n)
+{
+    if (!_scr.lite) {
+	addnstr (s, n == UINT_MAX ? -1 : (int) n);
+	return;
+    }
+    if (_scr.y >= _scr.lines)
+	return;
+    const unsigned o = _scr.y*_scr.cols;
+    for (unsigned i = 0; i < n && s[i] && _scr.x < _scr.cols; ++i, ++_scr.x) {
+	_scr.chars[o+_scr.x] = s[i];
+	_scr.attrs[o+_scr.x] = _scr.attr;
+    }
+}
+
+static void ScreenAddstr (const char* s)
+{
+    ScreenAddnstr (s, UINT_MAX);
+}
+
+static void ScreenAddch (char c)
+{
+    ScreenAddnstr (&c, 1);
+}
+
+static void ScreenPrintf (const char* fmt, ...)
+{
+    char buf [256];
+    va_list args;
+    va_start (args, fmt);
+    const int n = vsnprintf (buf, sizeof(buf), fmt, args);
+    va_end (args);
+    if (n > 0)
+	ScreenAddnstr (buf, min (n, sizeof(buf)-1));
+}
+
+static void WriteScreenCap (enum EScreenCap c)
+{
+    if (_scr.capLen[c] && 0 > write (STDOUT_FILENO, _scr.cap[c], _scr.capLen[c]))
+	_scr.capLen[c] = 0;
+}
+
+/// Matches the shadow buffers to the terminal size, clearing the terminal if it changed
+static void ResizeScreen (void)
+{
+    struct winsize ws;
+    if (0 > ioctl (STDOUT_FILENO, TIOCGWINSZ, &ws) || !ws.ws_col || !ws.ws_row) {
+	ws.ws_col = 80;
+	ws.ws_row = 24;
+    }
+    if (ws.ws_col == _scr.cols && ws.ws_row == _scr.lines)
+	return;
+    _scr.cols = ws.ws_col;
+    _scr.lines = ws.ws_row;
+    const size_t n = _scr.cols * _scr.lines;
+    _scr.chars = (char*) Realloc (_scr.chars, n);
+    _scr.attrs = (uint8_t*) Realloc (_scr.attrs, n);
+    _scr.shownChars = (char*) Realloc (_scr.shownChars, n);
+    _scr.shownAttrs = (uint8_t*) Realloc (_scr.shownAttrs, n);
+    memset (_scr.chars, ' ', n);
+    memset (_scr.attrs, 0, n);
+    memset (_scr.shownAttrs, 0, n);
+    // After clear_screen, the terminal shows blanks. Otherwise
+    // nothing it shows is known and everything is redrawn.
+    WriteScreenCap (scap_Sgr0);
+    WriteScreenCap (scap_Clear);
+    memset (_scr.shownChars, _scr.capLen[scap_Clear] ? ' ' : 0, n);
+}
+
+static void ScreenErase (void)
+{
+    if (!_scr.lite) {
+	erase();
+	return;
+    }
+    if (_scr.active)
+	ResizeScreen();
+    memset (_scr.chars, ' ', _scr.cols * _scr.lines);
+    memset (_scr.attrs, 0, _scr.cols * _scr.lines);
+}
+
+/// Expands cursor_address for row y and column x into out, returning its
+/// length. Only the operators found in cursor addressing strings are
+/// supported; expansion stops at any other.
+static unsigned ExpandCup (const char* cap, unsigned y, unsigned x, char* out)
+{
+    int param[2] = { y, x }, stack[8];
+    unsigned sp = 0, n = 0;
+    for (const char* p = cap; *p && n < SCREEN_CAP_SIZE-8; ++p) {
+	if (*p != '%') {
+	    out[n++] = *p;
+	    continue;
+	}
+	const char op = *++p;
+	if (op == '%')
+	    out[n++] = '%';
+	else if (op == 'i')
+	    ++param[0], ++param[1];
+	else if (op == 'p' && (p[1] == '1' || p[1] == '2') && sp < 8)
+	    stack[sp++] = param[*++p - '1'];
+	else if (op == '\'' && p[1] && p[2] == '\'' && sp < 8) {
+	    stack[sp++] = (unsigned char) p[1];
+	    p += 2;
+	} else if (op == '{' && sp < 8) {
+	    int v = 0;
+	    while (p[1] >= '0' && p[1] <= '9')
+		v = v*10 + (*++p - '0');
+	    p += (p[1] == '}');
+	    stack[sp++] = v;
+	} else if ((op == '+' || op == '-') && sp >= 2) {
+	    --sp;
+	    stack[sp-1] += op == '+' ? stack[sp] : -stack[sp];
+	} else if (op == 'c' && sp)
+	    out[n++] = stack[--sp];
+	else {	// %d with an optional width, as in %2d or %03d
+	    const bool zero = (*p == '0');
+	    int w = 0;
+	    for (; *p >= '0' && *p <= '9'; ++p)
+		w = w*10 + (*p - '0');
+	    if (*p != 'd' || !sp)
+		break;
+	    const int pn = snprintf (out+n, SCREEN_CAP_SIZE-n, zero ? "%0*d" : "%*d", min (w, 3), stack[--sp]);
+	    n = min (n + max (pn, 0), SCREEN_CAP_SIZE-1);
+	}
+    }
+    return n;
+}
+
+/// Writes all of iov to fd, continuing after partial writes
+static void WriteAll (int fd, struct iovec* iov, unsigned n)
+{
+    while (n) {
+	ssize_t bw = writev (fd, iov, n);
+	if (bw < 0) {
+	    if (errno == EINTR)
+		continue;
+	    return;
+	}
+	for (; n && (size_t) bw >= iov->iov_len; ++iov, --n)
+	    bw -= iov->iov_len;
+	if (n) {
+	    iov->iov_base = (char*) iov->iov_base + bw;
+	    iov->iov_len -= bw;
+	}
+    }
+}
+
+/// Writes the cells that differ from what the terminal shows. The pieces
+/// point into the shadow buffer and the prepared sequences, and are
+/// written together, so a frame is usually a single writev. Unchanged
+/// spans longer than a cursor move are skipped.
+static void RefreshScreen (void)
+{
+    struct iovec iov [SCREEN_IOV_MAX];
+    unsigned niov = 0;
+    #define PUSH(b,n)	(iov[niov].iov_base = (void*)(b), iov[niov++].iov_len = (n))
+    #define PUSH_CAP(c)	PUSH (_scr.cap[c], _scr.capLen[c])
+    // Written out before a group of up to 8 pieces could overflow iov
+    #define FLUSH_IF_FULL()	do { if (niov > SCREEN_IOV_MAX-8) { WriteAll (STDOUT_FILENO, iov, niov); niov = 0; } } while (false)
+    uint8_t attr = UINT8_MAX;	// Unknown until the first sgr0
+    unsigned cy = UINT_MAX, cx = 0;	// Cursor position, if known
+    const unsigned cols = _scr.cols;
+    for (unsigned y = 0; y < _scr.lines; ++y) {
+	const char* c = _scr.chars + y*cols;
+	const uint8_t* a = _scr.attrs + y*cols;
+	const char* sc = _scr.shownChars + y*cols;
+	const uint8_t* sa = _scr.shownAttrs + y*cols;
+	#define SAME(x)	(c[x] == sc[x] && a[x] == sa[x])
+	unsigned x1 = cols;
+	if (y == _scr.lines-1 && _scr.scrollsAtEnd)
+	    --x1;
+	while (x1 && SAME(x1-1))
+	    --x1;
+	// A blank tail of the row is cleared with el instead of written
+	unsigned xe = cols;
+	while (xe && c[xe-1] == ' ' && !a[xe-1])
+	    --xe;
+	const bool clearTail = xe < x1 && _scr.capLen[scap_El];
+	if (!clearTail)
+	    xe = x1;
+	for (unsigned x = 0; x < xe;) {
+	    FLUSH_IF_FULL();
+	    unsigned e = x;
+	    while (e < xe && SAME(e))
+		++e;
+	    if (e > x && (e - x > SCREEN_SKIP_MIN || e == xe)) {
+		x = e;
+		continue;
+	    }
+	    if (cy == y && cx == x)
+		;
+	    else if (x == 0 && y && cy == y-1)
+		PUSH ("\r\n", 2);
+	    else {
+		char* cup = _scr.cupOut [niov];
+		PUSH (cup, ExpandCup (_scr.cap[scap_Cup], y, x, cup));
+	    }
+	    if (a[x] != attr) {
+		attr = a[x];
+		PUSH_CAP (scap_Sgr0);
+		if (attr & attr_Bold)
+		    PUSH_CAP (scap_Bold);
+		if (attr & attr_Reverse)
+		    PUSH_CAP (scap_Rev);
+	    }
+	    // Extend the run over cells of the same attributes, stopping before a skippable span
+	    for (e = x+1; e < xe && a[e] == attr;) {
+		unsigned g = e;
+		while (g < xe && SAME(g) && a[g] == attr)
+		    ++g;
+		if (g - e > SCREEN_SKIP_MIN)
+		    break;
+		e = max (g, e+1);
+	    }
+	    PUSH (c+x, e-x);
+	    x = e;
+	    // At the right edge, the cursor may be waiting to wrap
+	    cy = x < cols ? y : UINT_MAX;
+	    cx = x;
+	}
+	#undef SAME
+	if (clearTail) {
+	    FLUSH_IF_FULL();
+	    if (cy != y || cx != xe) {
+		char* cup = _scr.cupOut [niov];
+		PUSH (cup, ExpandCup (_scr.cap[scap_Cup], y, xe, cup));
+		cy = y;
+		cx = xe;
+	    }
+	    if (attr) {
+		attr = 0;
+		PUSH_CAP (scap_Sgr0);
+	    }
+	    PUSH_CAP (scap_El);
+	}
+    }
+    #undef FLUSH_IF_FULL
+    #undef PUSH_CAP
+    #undef PUSH
+    WriteAll (STDOUT_FILENO, iov, niov);
+    memcpy (_scr.shownChars, _scr.chars, cols * _scr.lines);
+    memcpy (_scr.shownAttrs, _scr.attrs, cols * _scr.lines);
+}
+
+static void ScreenRefresh (void)
+{
+    if (!_scr.lite)
+	refresh();
+    else if (_scr.active)
+	RefreshScreen();
+}
+
+static void ScreenBeep (void)
+{
+    if (!_scr.lite)
+	beep();
+    else if (0 > write (STDOUT_FILENO, "\a", 1))
+	_scr.active = false;
+}
+
+/// Returns the next key typed, or ERR if there is none. Without curses,
+/// key sequences of the terminal's entry are decoded into curses codes.
+static int ScreenKey (void)
+{
+    if (!_scr.lite)
+	return getch();
+    if (_scr.inputLen < sizeof(_scr.input)) {
+	const ssize_t br = read (STDIN_FILENO, _scr.input+_scr.inputLen, sizeof(_scr.input)-_scr.inputLen);
+	if (br > 0)
+	    _scr.inputLen += br;
+	else if (br < 0 && errno != EAGAIN && errno != EINTR)
+	    _quitting = true;	// The terminal is gone, as EIO after a hangup
+    }
+    if (!_scr.inputLen)
+	return ERR;
+    int key = (unsigned char) _scr.input[0];
+    unsigned n = 1;
+    for (unsigned i = 0; i < NScreenKeys; ++i) {
+	if (_scr.keyLen[i] && _scr.keyLen[i] <= _scr.inputLen && 0 == memcmp (_scr.input, _scr.key[i], _scr.keyLen[i])) {
+	    key = c_ScreenKeys[i].key;
+	    n = _scr.keyLen[i];
+	    break;
+	}
+    }
+    memmove (_scr.input, _scr.input+n, _scr.inputLen -= n);
+    return key;
+}
+
+/// Copies string capability name of ti into out with any padding removed.
+/// Returns its length, or 0 if it is absent or too long.
+static unsigned PrepareScreenCap (const struct STerminfo* ti, const char* name, char* out)
+{
+    const unsigned r = FindValueByName (name);
+    unsigned slen = 0;
+    const char* s = (r >= FirstString && r < NValues) ? TerminfoString (ti, r-FirstString, &slen) : NULL;
+    unsigned n = 0;
+    for (unsigned i = 0; i < slen; ++i) {
+	const char* pe = (s[i] == '$' && i+1 < slen && s[i+1] == '<') ? memchr (s+i, '>', slen-i) : NULL;
+	if (pe)
+	    i = pe - s;
+	else if (n < SCREEN_CAP_SIZE-1)
+	    out[n++] = s[i];
+	else
+	    return out[0] = 0;
+    }
+    out[n] = 0;
+    return n;
+}
+
+/// Sets up the terminal for drawing without curses, with the sequences
+/// of the $TERM entry, or of the open entry if $TERM has none.
+static bool OpenScreen (void)
+{
+    struct STerminfo* termti = NULL;
+    const char* term = getenv ("TERM");
+    if (term && term[0] && !strchr (term, '/')) {
+	char termfile [PATH_MAX];
+	TermFilePath (term, termfile, sizeof(termfile));
+	termti = AcquireTerminfo (termfile);
+    }
+    const struct STerminfo* ti = termti ? termti : _info;
+    if (!ti)
+	return false;
+    for (unsigned i = 0; i < NScreenCaps; ++i)
+	_scr.capLen[i] = PrepareScreenCap (ti, c_ScreenCapNames[i], _scr.cap[i]);
+    for (unsigned i = 0; i < NScreenKeys; ++i)
+	_scr.keyLen[i] = PrepareScreenCap (ti, c_ScreenKeys[i].name, _scr.key[i]);
+    _scr.scrollsAtEnd = TerminfoBoolean (ti, FindValueByName ("auto_right_margin") - FirstBoolean);
+    ReleaseTerminfo (termti);
+    if (!_scr.capLen[scap_Cup] || 0 > tcgetattr (STDIN_FILENO, &_scr.savedTermios))
+	return false;
+    struct termios t = _scr.savedTermios;
+    t.c_lflag &= ~(ICANON| ECHO);
+    t.c_cc[VMIN] = 0;
+    t.c_cc[VTIME] = 0;
+    tcsetattr (STDIN_FILENO, TCSANOW, &t);
+    _scr.active = true;
+    WriteScreenCap (scap_Smcup);
+    WriteScreenCap (scap_Smkx);
+    WriteScreenCap (scap_Civis);
+    ResizeScreen();
+    return true;
+}
+
+/// Restores the terminal set up by OpenScreen
+static void CloseScreen (void)
+{
+    if (!_scr.active)
+	return;
+    _scr.active = false;
+    WriteScreenCap (scap_Sgr0);
+    WriteScreenCap (scap_Cnorm);
+    WriteScreenCap (scap_Rmkx);
+    if (_scr.capLen[scap_Rmcup])
+	WriteScreenCap (scap_Rmcup);
+    else {	// Leave the cursor below the last frame
+	char cup [SCREEN_CAP_SIZE];
+	if (0 > write (STDOUT_FILENO, cup, ExpandCup (_scr.cap[scap_Cup], _scr.lines-1, 0, cup))
+		|| 0 > write (STDOUT_FILENO, "\r\n", 2))
+	    _scr.capLen[scap_Cup] = 0;
+    }
+    tcsetattr (STDIN_FILENO, TCSAFLUSH, &_scr.savedTermios);
+    Free (_scr.chars);
+    Free (_scr.attrs);
+    Free (_scr.shownChars);
+    Free (_scr.shownAttrs);
+    _scr.chars = _scr.shownChars = NULL;
+    _scr.attrs = _scr.shownAttrs = NULL;
+    _scr.cols = _scr.lines = 0;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ UI
+
+static void FillRect (unsigned x, unsigned y, unsigned w, unsigned h)
+{
+    for (unsigned j = 0; j < h; ++j) {
+	ScreenMove (y+j, x);
+	for (unsigned i = 0; i < w; ++i)
+	    ScreenAddch (' ');
+    }
+}
+
+static inline void SetColor (enum EUIColor c, bool selected)
+{
+    ScreenAttr (_color[c+selected*4]);
+}
+
+/// Columns taken by byte c of a value when drawn escaped
+static inline unsigned EscapedWidth (unsigned char c)
+{
+    return c < ' ' ? 2 : c > '~' ? 4 : 1;
+}
+
+static unsigned ValueColumns (void)
+{
+    const unsigned reserved = VALUE_COLUMN + (_prevalence.shown ? PREVALENCE_COLUMNS : 0);
+    return ScreenCols() > reserved ? ScreenCols() - reserved : 1;
+}
+
+/// Returns the bytes of value v as they are drawn, in buf for numbers
+static const char* ValueText (const struct SValue* v, char* buf, size_t bufsz, unsigned* plen)
+{
+    const char* s = v->string;
+    *plen = v->slen;
+    if (v->type == type_Boolean)
+	*plen = strlen (s = (v->number == 1 ? "true" : "false"));
+    else if (v->type == type_Number)
+	*plen = min (snprintf (buf, bufsz, "%d", v->number), bufsz-1), s = buf;
+    return s;
+}
+
+/// Lays out the open entry's values, if the entry or the screen width changed
+static void UpdateLayout (void)
+{
+    if (_layout.ti == _info && _layout.cols == ScreenCols())
+	return;
+    _layout.ti = _info;
+    _layout.cols = ScreenCols();
+    _layout.n = TerminfoRows (_info);
+    _layout.maxWidth = 0;
+    _layout.nBreaks = 0;
+    _layout.width = (uint32_t*) Realloc (_layout.width, _layout.n * sizeof(uint32_t));
+    _layout.firstBreak = (uint32_t*) Realloc (_layout.firstBreak, (_layout.n+1) * sizeof(uint32_t));
+    const unsigned vw = ValueColumns();
+    for (unsigned r = 0; r < _layout.n; ++r) {
+	struct SValue v;
+	GetRowValue (_info, r, &v);
+	char nbuf [16];
+	unsigned slen;
+	const char* s = ValueText (&v, nbuf, sizeof(nbuf), &slen);
+	_layout.firstBreak[r] = _layout.nBreaks;
+	unsigned w = 0, lw = 0;
+	for (unsigned i = 0; i < slen; ++i) {
+	    const unsigned cw = EscapedWidth (s[i]);
+	    if (lw && lw + cw > vw) {
+		if (_layout.nBreaks >= _layout.breaksCapacity) {
+		    _layout.breaksCapacity = max (64, 2*_layout.breaksCapacity);
+		    _layout.breaks = (uint32_t*) Realloc (_layout.breaks, _layout.breaksCapacity * sizeof(uint32_t));
+		}
+		_layout.breaks[_layout.nBreaks++] = i;
+		lw = 0;
+	    }
+	    lw += cw;
+	    w += cw;
+	}
+	_layout.width[r] = w;
+	_layout.maxWidth = max (_layout.maxWidth, w);
+    }
+    _layout.firstBreak[_layout.n] = _layout.nBreaks;
+}
+
+/// Forgets the layout and sort order, for when the open entry is replaced
+static void InvalidateLayout (void)
+{
+    _layout.ti = NULL;
+    _sorted.ti = NULL;
+}
+
+static int CompareValueNames (const void* a, const void* b)
+{
+    return strcmp (ValueName (*(const uint16_t*)a), ValueName (*(const uint16_t*)b));
+}
+
+static int CompareValueShortNames (const void* a, const void* b)
+{
+    return strcmp (ValueShortName (*(const uint16_t*)a), ValueShortName (*(const uint16_t*)b));
+}
+
+static int CompareExtRowNames (const void* a, const void* b)
+{
+    return strcmp (ExtName (_info, *(const uint32_t*)a - NValues), ExtName (_info, *(const uint32_t*)b - NValues));
+}
+
+/// Standard value rows in name or capname order. The names are fixed, so each is sorted once.
+static const uint16_t* StandardNameOrder (bool shortNames)
+{
+    static uint16_t s_Order [2][NValues];
+    static bool s_Sorted [2] = { false, false };
+    uint16_t* order = s_Order[shortNames];
+    if (!s_Sorted[shortNames]) {
+	for (unsigned r = 0; r < NValues; ++r)
+	    order[r] = r;
+	qsort (order, NValues, sizeof(order[0]), shortNames ? CompareValueShortNames : CompareValueNames);
+	s_Sorted[shortNames] = true;
+    }
+    return order;
+}
+
+struct SSortKey {
+    uint32_t	key;
+    uint32_t	row;
+};
+
+static int CompareSortKeys (const void* a, const void* b)
+{
+    const struct SSortKey* ka = (const struct SSortKey*) a;
+    const struct SSortKey* kb = (const struct SSortKey*) b;
+    if (ka->key != kb->key)
+	return ka->key < kb->key ? -1 : 1;
+    return ka->row < kb->row ? -1 : ka->row > kb->row;
+}
+
+/// Computes the permutation of rows for _sortOrder, if the entry or the order changed
+static void UpdateSortedRows (void)
+{
+    if (_sorted.ti == _info && _sorted.order == _sortOrder)
+	return;
+    _sorted.ti = _info;
+    _sorted.order = _sortOrder;
+    const unsigned n = _sorted.n = TerminfoRows (_info);
+    uint32_t* row = _sorted.row = (uint32_t*) Realloc (_sorted.row, n * sizeof(uint32_t));
+    for (unsigned r = 0; r < n; ++r)
+	row[r] = r;
+    if (_sortOrder == sort_Name || _sortOrder == sort_ShortName) {
+	// Extended rows are sorted, then merged with the presorted standard rows
+	const bool shortNames = (_sortOrder == sort_ShortName);
+	const unsigned nx = n - NValues;
+	uint32_t* xrow = (uint32_t*) Realloc (NULL, nx * sizeof(uint32_t));
+	memcpy (xrow, row+NValues, nx * sizeof(uint32_t));
+	qsort (xrow, nx, sizeof(uint32_t), CompareExtRowNames);
+	const uint16_t* srow = StandardNameOrder (shortNames);
+	for (unsigned i = 0, j = 0, k = 0; k < n; ++k) {
+	    if (j >= nx || (i < NValues && 0 >= strcmp (shortNames ? ValueShortName (srow[i]) : ValueName (srow[i]), ExtName (_info, xrow[j]-NValues))))
+		row[k] = srow[i++];
+	    else
+		row[k] = xrow[j++];
+	}
+	Free (xrow);
+    } else if (_sortOrder == sort_Length) {
+	struct SSortKey* keys = (struct SSortKey*) Realloc (NULL, n * sizeof(struct SSortKey));
+	for (unsigned r = 0; r < n; ++r) {
+	    struct SValue v;
+	    GetRowValue (_info, r, &v);
+	    char nbuf [16];
+	    unsigned slen;
+	    ValueText (&v, nbuf, sizeof(nbuf), &slen);
+	    keys[r].key = UINT32_MAX - (v.type == type_String ? slen : 0);
+	    keys[r].row = r;
+	}
+	qsort (keys, n, sizeof(struct SSortKey), CompareSortKeys);
+	for (unsigned i = 0; i < n; ++i)
+	    row[i] = keys[i].row;
+	Free (keys);
+    } else if (_sortOrder == sort_Defined) {
+	// A stable partition, defined rows first
+	unsigned k = 0;
+	for (unsigned pass = 0; pass < 2; ++pass) {
+	    for (unsigned r = 0; r < n; ++r) {
+		struct SValue v;
+		GetRowValue (_info, r, &v);
+		const bool defined = (v.type == type_Boolean ? v.number == 1 : IsDefinedValue (&v));
+		if (defined == !pass)
+		    row[k++] = r;
+	    }
+	}
+    }
+}
+
+/// The row at position p of the current order
+static inline unsigned SortedRow (unsigned p)
+{
+    UpdateSortedRows();
+    return _sorted.row[p];
+}
+
+/// Switches to the next sort order, keeping the selected row selected
+static void NextSortOrder (void)
+{
+    const unsigned r = SortedRow (_selection), offset = _selection - _topline;
+    _sortOrder = (_sortOrder+1) % NSortOrders;
+    UpdateSortedRows();
+    unsigned p = 0;
+    while (p < _sorted.n-1 && _sorted.row[p] != r)
+	++p;
+    _selection = p;
+    _topline = p - min (p, offset);
+}
+
+/// Screen lines taken by row r
+static inline unsigned RowLines (unsigned r)
+{
+    return _wrap ? 1 + _layout.firstBreak[r+1] - _layout.firstBreak[r] : 1;
+}
+
+/// Draws bytes [b,e) of value s escaped, with the first skip columns
+/// scrolled off, in at most w columns.
+static void DrawValueText (const char* s, unsigned b, unsigned e, unsigned skip, unsigned w, bool selected)
+{
+    SetColor (color_Value, selected);
+    for (unsigned i = b, col = 0; i < e; ++i) {
+	const unsigned char c = s[i];
+	const unsigned cw = EscapedWidth (c);
+	col += cw;
+	if (col <= skip)
+	    continue;
+	if (col - cw < skip) {	// Partly scrolled off
+	    for (unsigned p = col - skip; p && w; --p, --w)
+		ScreenAddch (' ');
+	    continue;
+	}
+	if (cw > w)
+	    break;
+	w -= cw;
+	if (cw > 1) {
+	    SetColor (color_ValueSpecial, selected);
+	    if (c < ' ') {
+		ScreenAddch ('^');
+		ScreenAddch ('A'-1+c);
+	    } else
+		ScreenPrintf ("\\%o", c);
+	    SetColor (color_Value, selected);
+	} else
+	    ScreenAddch (c);
+    }
+}
+
+/// Draws row r from screen line l, on one line, or in wrap mode on as
+/// many as it needs, up to maxLines. Returns the number of lines drawn.
+static unsigned DrawRow (unsigned l, unsigned r, unsigned maxLines)
+{
+    const bool selected = (r == SortedRow (_selection));
+    const unsigned nLines = min (RowLines (r), maxLines);
+    struct SValue v;
+    GetRowValue (_info, r, &v);
+    char nbuf [16];
+    unsigned slen;
+    const char* s = ValueText (&v, nbuf, sizeof(nbuf), &slen);
+    const uint32_t* breaks = _layout.breaks + _layout.firstBreak[r];
+    for (unsigned k = 0; k < nLines; ++k) {
+	if (selected) {
+	    SetColor (color_Selection, false);
+	    FillRect (0, l+k, ScreenCols(), 1);
+	}
+	if (!k) {
+	    if (!selected && r < _watch.changedRows && (_watch.changed[r/8] & (1u << (r%8))))
+		ScreenAttr (_color[color_Changed]);
+	    else
+		SetColor (color_Name, selected);
+	    ScreenMove (l, 1);
+	    ScreenPrintf ("%-*.*s: ", NAME_COLUMNS, NAME_COLUMNS, v.name);
+	}
+	ScreenMove (l+k, VALUE_COLUMN);
+	const unsigned b = k ? breaks[k-1] : 0, e = k+1 < RowLines (r) ? breaks[k] : slen;
+	DrawValueText (s, b, e, _wrap ? 0 : _hscroll, ValueColumns(), selected);
+	if (!k && _prevalence.shown && ScreenCols() > VALUE_COLUMN + PREVALENCE_COLUMNS) {
+	    unsigned defined, same;
+	    SetColor (color_Name, selected);
+	    ScreenMove (l, ScreenCols() - PREVALENCE_COLUMNS);
+	    if (ValuePrevalence (&v, &defined, &same))
+		ScreenPrintf (" %5u %5u", defined, same);
+	    else
+		ScreenPrintf (" %5u %5s", defined, "-");
+	}
+    }
+    return nLines;
+}
+
+/// In wrap mode, moves _topline down until all lines of the selected row fit
+static void FitSelection (void)
+{
+    const unsigned nLines = ScreenLines()-1;
+    unsigned used = 0;
+    for (unsigned p = _topline; p <= _selection; ++p)
+	used += RowLines (SortedRow (p));
+    while (used > nLines && _topline < _selection)
+	used -= RowLines (SortedRow (_topline++));
+}
+
+static void DrawEntry (void)
+{
+    UpdateLayout();
+    if (_wrap)
+	FitSelection();
+    const unsigned nRows = TerminfoRows (_info), nLines = ScreenLines()-1;
+    for (unsigned l = 0, p = _topline; l < nLines && p < nRows; ++p)
+	l += DrawRow (l, SortedRow (p), nLines-l);
+    ScreenAttr (_color[color_StatusLine]);
+    FillRect (0, ScreenLines()-1, ScreenCols(), 1);
+    ScreenMove (ScreenLines()-1, 1);
+    ScreenAddstr (_info->name);
+    static const char c_SortNames [NSortOrders][8] = { "", "name", "capname", "length", "defined" };
+    if (_sortOrder != sort_Section)
+	ScreenPrintf ("  [by %s]", c_SortNames[_sortOrder]);
+    if (_wrap)
+	ScreenAddstr ("  [wrap]");
+    else if (_hscroll)
+	ScreenPrintf ("  [+%u]", _hscroll);
+    if (_prevalence.shown)
+	ScreenPrintf ("  [defined, same in %u]", _prevalence.h->nEntries);
+    const unsigned r = SortedRow (_selection);
+    if (r < NValues)
+	ScreenPrintf ("  %s (%s): %s", ValueShortName (r), ValueTermcap (r), ValueDescription (r));
+    ScreenAttr (A_NORMAL);
+}
+
+static void FreeHexView (void)
+{
+    Free (_hex.p);
+    _hex.p = NULL;
+    _hex.size = 0;
+}
+
+/// Sets the bytes of row r of the open entry to be marked in the hex view
+static void MarkHexRow (unsigned r)
+{
+    const struct STerminfo* ti = _info;
+    struct STerminfoLayout l;
+    TerminfoLayout (&ti->h, &l);
+    const size_t xbooleans = l.end + l.end%2 + sizeof(struct STerminfoExtHeader),
+		xnumbers = xbooleans + ti->xh.nBooleans + ti->xh.nBooleans%2,
+		xoffsets = xnumbers + ti->xh.nNumbers * l.numberSize,
+		xstrtable = xoffsets + (ti->xh.nStrings*2 + ti->xh.nBooleans + ti->xh.nNumbers) * sizeof(uint16_t);
+    const unsigned xb = NValues, xn = xb + ti->xh.nBooleans, xs = xn + ti->xh.nNumbers;
+    size_t vo = 0, vsize = 0, so = 0;
+    unsigned slen = 0;
+    if (r < FirstNumber && r-FirstBoolean < ti->h.nBooleans)
+	vo = l.booleans + (r-FirstBoolean), vsize = 1;
+    else if (r >= FirstNumber && r < FirstString && r-FirstNumber < ti->h.nNumbers)
+	vo = l.numbers + (r-FirstNumber)*l.numberSize, vsize = l.numberSize;
+    else if (r >= FirstString && r < NValues && r-FirstString < ti->h.nStrings) {
+	vo = l.strings + (r-FirstString)*sizeof(uint16_t), vsize = sizeof(uint16_t);
+	if (TerminfoString (ti, r-FirstString, &slen))
+	    so = l.strtable + ti->astro[r-FirstString];
+    } else if (r >= xb && r < xn)
+	vo = xbooleans + (r-xb), vsize = 1;
+    else if (r >= xn && r < xs)
+	vo = xnumbers + (r-xn)*l.numberSize, vsize = l.numberSize;
+    else if (r >= xs && r < TerminfoRows (ti)) {
+	vo = xoffsets + (r-xs)*sizeof(uint16_t), vsize = sizeof(uint16_t);
+	const unsigned o = ti->xstro[r-xs];
+	if (o < ti->xh.strtableSize) {
+	    so = xstrtable + o;
+	    slen = strlen (ti->xstrings+o);
+	}
+    }
+    _hex.markStart[0] = vo;
+    _hex.markEnd[0] = vo + vsize;
+    _hex.markStart[1] = so;
+    _hex.markEnd[1] = so ? so + slen + 1 : 0;
+}
+
+/// Reads the file of the open entry, if not read, and finds its sections.
+/// The bytes are copied rather than mapped, because the watched file may
+/// be truncated and rewritten while it is shown.
+static bool ReadHexView (void)
+{
+    if (_hex.p)
+	return true;
+    size_t size = _infoBytesSize;
+    uint8_t* p = _infoPath[0] ? (uint8_t*) ReadWholeFile (_infoPath, &size)
+		: _infoBytes ? (uint8_t*) memcpy (Realloc (NULL, size), _infoBytes, size) : NULL;
+    if (!p)
+	return false;
+    if (!size) {
+	Free (p);
+	return false;
+    }
+    _hex.p = p;
+    _hex.size = size;
+    struct STerminfoLayout l;
+    TerminfoLayout (&_info->h, &l);
+    const size_t ends [NHexSections] = {
+	l.name, l.booleans, l.booleans + _info->h.nBooleans, l.numbers,
+	l.strings, l.strtable, l.end, _hex.size
+    };
+    for (unsigned i = 0; i < NHexSections; ++i)
+	_hex.sectionEnd[i] = min (ends[i], _hex.size);
+    MarkHexRow (SortedRow (_selection));
+    return true;
+}
+
+static enum EHexSection HexSection (size_t o)
+{
+    unsigned s = 0;
+    while (s < NHexSections-1 && o >= _hex.sectionEnd[s])
+	++s;
+    return s;
+}
+
+static unsigned HexRows (void)
+{
+    return (_hex.size + HEX_LINE_BYTES-1) / HEX_LINE_BYTES;
+}
+
+/// Shows the file of the open entry, at the bytes of the selected capability
+static void OpenHexView (void)
+{
+    FreeHexView();
+    if (!ReadHexView()) {
+	ScreenBeep();
+	return;
+    }
+    _view = view_Hex;
+    _hex.line = min (_hex.markStart[0] / HEX_LINE_BYTES, HexRows()-1);
+    const unsigned pageSize = ScreenLines()-1;
+    _hex.topline = _hex.line > pageSize/2 ? _hex.line - pageSize/2 : 0;
+}
+
+/// Only the visible lines are formatted, straight from the copied bytes
+static void DrawHex (void)
+{
+    if (!ReadHexView()) {
+	_view = view_Entry;
+	DrawEntry();
+	return;
+    }
+    static const char c_SectionNames [NHexSections][12] = {
+	"header", "names", "booleans", "pad", "numbers", "offsets", "strtable", "extended"
+    };
+    const unsigned nLines = min (HexRows()-min(_hex.topline,HexRows()), ScreenLines()-1);
+    for (unsigned l = 0; l < nLines; ++l) {
+	const size_t o = (size_t)(_hex.topline+l) * HEX_LINE_BYTES;
+	const unsigned n = min (HEX_LINE_BYTES, _hex.size - o);
+	SetColor (color_Name, _hex.topline+l == _hex.line);
+	ScreenMove (l, 1);
+	ScreenPrintf ("%08zx", o);
+	for (unsigned i = 0; i < n; ++i) {
+	    const size_t bo = o+i;
+	    unsigned attr = _color[color_HexHeader + HexSection (bo)];
+	    if ((bo >= _hex.markStart[0] && bo < _hex.markEnd[0]) || (bo >= _hex.markStart[1] && bo < _hex.markEnd[1]))
+		attr |= A_REVERSE;
+	    ScreenAttr (attr);
+	    const uint8_t c = _hex.p[bo];
+	    ScreenMove (l, 11 + i*3 + (i >= HEX_LINE_BYTES/2));
+	    ScreenPrintf ("%02x", c);
+	    ScreenMove (l, 12 + HEX_LINE_BYTES*3 + 1 + i);
+	    ScreenAddch (c >= ' ' && c <= '~' ? c : '.');
+	}
+    }
+    ScreenAttr (_color[color_StatusLine]);
+    FillRect (0, ScreenLines()-1, ScreenCols(), 1);
+    ScreenMove (ScreenLines()-1, 1);
+    const size_t lo = (size_t) _hex.line * HEX_LINE_BYTES;
+    ScreenPrintf ("%s  [hex %zx/%zx, %s]", _info->name, lo, _hex.size, c_SectionNames [HexSection (lo)]);
+    ScreenAttr (A_NORMAL);
+}
+
+/// Only the visible slice of the list is drawn, so its size does not matter
+static void DrawBrowser (void)
+{
+    const unsigned nRows = BrowserRows(), nVisible = min (nRows-min(_terms.topline,nRows), ScreenLines()-1);
+    for (unsigned l = 0; l < nVisible; ++l) {
+	const bool selected = (_terms.topline+l == _terms.selection);
+	if (selected) {
+	    SetColor (color_Selection, false);
+	    FillRect (0, l, ScreenCols(), 1);
+	}
+	SetColor (color_Name, selected);
+	const char* name = _terms.name[BrowserTerm(_terms.topline+l)];
+	const char* basename = strchr (name, '/');
+	ScreenMove (l, 1);
+	ScreenPrintf ("%-26s ", basename ? basename+1 : name);
+	SetColor (color_Value, selected);
+	ScreenAddnstr (name+strlen(name)+1, ScreenCols() > 28 ? ScreenCols()-28 : 0);
+    }
+    ScreenAttr (_color[color_StatusLine]);
+    FillRect (0, ScreenLines()-1, ScreenCols(), 1);
+    ScreenMove (ScreenLines()-1, 1);
+    if (_filter.qlen || _filter.editing)
+	ScreenPrintf ("/%s  [%u/%u]", _filter.query, _filter.n, _terms.n);
+    else
+	ScreenPrintf ("%u terminals", _terms.n);
+    if (!ScanFinished())
+	ScreenAddstr (", scanning ...");
+    ScreenAttr (A_NORMAL);
+}
+
+static void Draw (void)
+{
+    const uint64_t t = TraceBegin();
+    ScreenErase();
+    if (_view == view_Browser)
+	DrawBrowser();
+    else if (_view == view_Hex)
+	DrawHex();
+    else
+	DrawEntry();
+    TraceSpan ("draw", t, 0);
+}
+
+/// Cursor movement shared by all list views
+static void OnListKey (unsigned key, unsigned n, unsigned* ptopline, unsigned* pselection)
+{
+    const unsigned pageSize = ScreenLines()-1;
+    unsigned sel = *pselection, top = *ptopline;
+    if (!n)
+	return;
+    if (key == KEY_HOME || key == '0')
+	sel = 0;
+    else if (key == KEY_END || key == 'G')
+	sel = n-1;
+    else if (key == 'H')
+	sel = top;
+    else if (key == 'M')
+	sel = top+(pageSize-1)/2;
+    else if (key == 'L')
+	sel = top+(pageSize-1);
+    else if ((key == KEY_UP || key == 'k') && sel > 0)
+	--sel;
+    else if ((key == KEY_DOWN || key == 'j') && sel < n-1)
+	++sel;
+    else if (key == KEY_PPAGE || key == 'b') {
+	if (sel > pageSize)
+	    sel -= pageSize;
+	else
+	    sel = 0;
+    } else if (key == KEY_NPAGE || key == ' ') {
+	if (sel + pageSize < n-1)
+	    sel += pageSize;
+	else
+	    sel = n-1;
+    }
+    sel = min (sel, n-1);
+    if (top > sel)
+	top = sel;
+    if (top + pageSize-1 < sel)
+	top = sel - (pageSize-1);
+    *pselection = sel;
+    *ptopline = top;
+}
+
+/// Shows or hides the prevalence column. The first time, the census may
+/// take seconds if not cached, so the status line says so meanwhile.
+static void TogglePrevalence (void)
+{
+    if (!_prevalence.shown && !_prevalence.h) {
+	ScreenAttr (_color[color_StatusLine]);
+	FillRect (0, ScreenLines()-1, ScreenCols(), 1);
+	ScreenMove (ScreenLines()-1, 1);
+	ScreenAddstr ("Counting values in the database...");
+	ScreenAttr (A_NORMAL);
+	ScreenRefresh();
+	if (!LoadPrevalence()) {
+	    ScreenBeep();
+	    return;
+	}
+    }
+    _prevalence.shown = !_prevalence.shown;
+    _layout.ti = NULL;	// Values are narrower with the column
+}
+
+static void OnEntryKey (unsigned key)
+{
+    const unsigned step = max (ValueColumns()/2, 1);
+    if (key == KEY_ESCAPE || key == 'q') {
+	if (_browsing)
+	    _view = view_Browser;
+	else
+	    _quitting = true;
+    } else if (key == 'w')
+	_wrap = !_wrap;
+    else if (key == 'x')
+	OpenHexView();
+    else if (key == 's')
+	NextSortOrder();
+    else if (key == 'p')
+	TogglePrevalence();
+    else if ((key == KEY_RIGHT || key == 'l') && !_wrap) {
+	UpdateLayout();
+	if (_hscroll + step < _layout.maxWidth)
+	    _hscroll += step;
+    } else if ((key == KEY_LEFT || key == 'h') && !_wrap)
+	_hscroll -= min (_hscroll, step);
+    else
+	OnListKey (key, TerminfoRows (_info), &_topline, &_selection);
+}
+
+static void OnHexKey (unsigned key)
+{
+    if (key == KEY_ESCAPE || key == 'q' || key == 'x')
+	_view = view_Entry;
+    else
+	OnListKey (key, HexRows(), &_hex.topline, &_hex.line);
+}
+
+static void OpenSelectedTerm (void)
+{
+    if (_terms.selection >= BrowserRows())
+	return;
+    char termfile [PATH_MAX];
+    snprintf (termfile, sizeof(termfile), "%s/%s", TerminfoDbPath(), _terms.name[BrowserTerm(_terms.selection)]);
+    struct STerminfo* ti = AcquireTerminfo (termfile);
+    if (!ti) {
+	ScreenBeep();
+	return;
+    }
+    ReleaseTerminfo (_info);
+    _info = ti;
+    snprintf (_infoPath, sizeof(_infoPath), "%s", termfile);
+    InvalidateLayout();
+    FreeHexView();
+    WatchEntryFile (termfile);
+    _topline = _selection = _hscroll = 0;
+    _view = view_Entry;
+}
+
+static void OnBrowserKey (unsigned key)
+{
+    const unsigned oldsel = _terms.selection, oldrows = BrowserRows();
+    if (key == KEY_ENTER || key == '\n' || key == '\r') {
+	_filter.editing = false;
+	OpenSelectedTerm();
+    } else if (key == KEY_ESCAPE && (_filter.qlen || _filter.editing)) {
+	_filter.query[_filter.qlen = 0] = 0;
+	_filter.editing = false;
+	FilterTerms();
+    } else if (_filter.editing && key >= ' ' && key <= '~') {
+	if (_filter.qlen < sizeof(_filter.query)-1) {
+	    _filter.query[_filter.qlen++] = (key >= 'A' && key <= 'Z') ? key+('a'-'A') : key;
+	    _filter.query[_filter.qlen] = 0;
+	    FilterTerms();
+	}
+    } else if (_filter.editing && (key == KEY_BACKSPACE || key == '\b' || key == 127)) {
+	if (_filter.qlen) {
+	    _filter.query[--_filter.qlen] = 0;
+	    FilterTerms();
+	} else
+	    _filter.editing = false;
+    } else if (key == '/')
+	_filter.editing = true;
+    else if (key == KEY_ESCAPE || key == 'q')
+	_quitting = true;
+    else
+	OnListKey (key, BrowserRows(), &_terms.topline, &_terms.selection);
+    if (_view == view_Browser && (_terms.selection != oldsel || BrowserRows() != oldrows))
+	PrefetchAroundSelection (_terms.selection < oldsel ? -1 : 1);
+}
+
+static void OnKey (unsigned key)
+{
+    if (_view == view_Browser)
+	OnBrowserKey (key);
+    else if (_view == view_Hex)
+	OnHexKey (key);
+    else
+	OnEntryKey (key);
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Process housekeeping
+
+static void StartupMark (enum EStartupPhase p)
+{
+    if (_startup.enabled && !_startup.t[p])
+	_startup.t[p] = NowNs() - _startup.start;
+}
+
+static void PrintStartupProfile (void)
+{
+    static const char* const c_PhaseNames [NStartupPhases] = { "loaded", "UI", "first frame", "colors" };
+    fputs ("Startup:", stdout);
+    for (unsigned i = 0; i < NStartupPhases; ++i)
+	if (_startup.t[i])
+	    printf ("%s %s %.2f ms", i ? "," : "", c_PhaseNames[i], _startup.t[i]/1e6);
+    putchar ('\n');
+}
+
+static void InitUI (void)
+{
+    if (_scr.lite) {
+	if (!OpenScreen()) {
+	    puts ("Error: unable to initialize UI without curses");
+	    exit (EXIT_FAILURE);
+	}
+	return;
+    }
+    if (!initscr()) {
+	puts ("Error: unable to initialize UI");
+	exit (EXIT_FAILURE);
+    }
+    cbreak();
+    noecho();
+    keypad (stdscr, true);
+    nodelay (stdscr, true);
+    curs_set (false);
+}
+
+/// Sets up color pairs, returning true if the screen must be redrawn
+/// with them. This is done after the first frame is shown, which uses
+/// only the attributes in _color.
+static bool InitColors (void)
+{
+    if (_scr.lite || !has_colors())
+	return false;
+    start_color();
+    use_default_colors();
+    for (unsigned i = 0; i < NColors; ++i) {
+	init_pair (i+1, c_Pairs[i][0], c_Pairs[i][1]);
+	_color[i] |= COLOR_PAIR(i+1);
+    }
+    return true;
+}
+
+/// Starts watching the entry file at path, replacing the previous watch
+static void WatchEntryFile (const char* path)
+{
+    _watch.changedRows = 0;
+    if (_watch.fd < 0 && 0 > (_watch.fd = inotify_init1 (IN_NONBLOCK| IN_CLOEXEC)))
+	return;
+    if (_watch.wd >= 0)
+	inotify_rm_watch (_watch.fd, _watch.wd);
+    snprintf (_watch.path, sizeof(_watch.path), "%s", path);
+    // Watch the directory, since tic may replace the file instead of rewriting it
+    char* sep = strrchr (_watch.path, '/');
+    if (!sep) {
+	_watch.wd = -1;
+	return;
+    }
+    *sep = 0;
+    _watch.wd = inotify_add_watch (_watch.fd, _watch.path, IN_CLOSE_WRITE| IN_MOVED_TO);
+    *sep = '/';
+    _watch.basename = sep+1;
+}
+
+/// Reloads the open entry if the watch reports it changed, and
+/// repaints only the rows that differ from the loaded copy.
+static void OnWatchEvent (void)
+{
+    bool modified = false;
+    union {
+	struct inotify_event e;
+	char buf [sizeof(struct inotify_event) + NAME_MAX + 1];
+    } ebuf;
+    for (ssize_t br; 0 < (br = read (_watch.fd, &ebuf, sizeof(ebuf)));) {
+	for (const char* p = ebuf.buf; p < ebuf.buf+br;) {
+	    const struct inotify_event* e = (const struct inotify_event*) p;
+	    if (e->wd == _watch.wd && e->len && 0 == strcmp (e->name, _watch.basename))
+		modified = true;
+	    p += sizeof(*e) + e->len;
+	}
+    }
+    if (!modified || !_info)
+	return;
+    struct STerminfo* ti = AcquireTerminfo (_watch.path);
+    if (!ti || ti == _info) {
+	ReleaseTerminfo (ti);
+	return;	// Partially written, wait for the next event
+    }
+    const unsigned nOldRows = TerminfoRows (_info);
+    _watch.changedRows = TerminfoRows (ti);
+    _watch.changed = (uint8_t*) Realloc (_watch.changed, (_watch.changedRows+7)/8);
+    DiffTerminfo (_info, ti, _watch.changed);
+    ReleaseTerminfo (_info);
+    _info = ti;
+    InvalidateLayout();
+    FreeHexView();
+    _selection = min (_selection, _watch.changedRows-1);
+    _topline = min (_topline, _selection);
+    if (_view == view_Hex)
+	Draw();	// Rereads the new file
+    if (_view != view_Entry)
+	return;
+    if (nOldRows != _watch.changedRows || _wrap || _sortOrder != sort_Section) {	// Rows may have moved or changed height
+	Draw();
+	return;
+    }
+    UpdateLayout();
+    const unsigned nVisible = min (_watch.changedRows-_topline, ScreenLines()-1);
+    for (unsigned l = 0; l < nVisible; ++l) {
+	const unsigned r = SortedRow (_topline+l);
+	if (_watch.changed[r/8] & (1u << (r%8))) {
+	    SetColor (color_Value, false);
+	    FillRect (0, l, ScreenCols(), 1);
+	    DrawRow (l, r, 1);
+	}
+    }
+}
+
+/// Runs until quit. The first frame is shown as soon as the visible rows
+/// are drawn; colors are set up after it, and applied with a redraw.
+static void EventLoop (void)
+{
+    bool redraw = true, colored = false;
+    while (!_quitting) {
+	int waitms = -1;
+	if (_browsing) {
+	    redraw |= CollectScannedNames();
+	    if (!ScanFinished())
+		waitms = SCAN_POLL_MS;
+	}
+	if (redraw)
+	    Draw();
+	const uint64_t t = TraceBegin();
+	ScreenRefresh();
+	TraceSpan ("refresh", t, 0);
+	redraw = false;
+	if (!colored) {
+	    StartupMark (startup_FirstFrame);
+	    colored = true;
+	    redraw = InitColors();
+	    continue;
+	}
+	StartupMark (startup_ColorFrame);
+	if (_startup.enabled)
+	    break;	// Only the startup is profiled
+	struct pollfd pfd[2] = {{ STDIN_FILENO, POLLIN, 0 }, { _watch.fd, POLLIN, 0 }};
+	if (0 >= poll (pfd, 1+(_watch.fd >= 0), waitms))
+	    continue;
+	if (pfd[1].revents & POLLIN)
+	    OnWatchEvent();
+	if (pfd[0].revents & (POLLHUP| POLLERR))
+	    _quitting = true;	// Keys can no longer come, so poll would never block
+	else if (pfd[0].revents & POLLIN) {
+	    unsigned nKeys = 0;
+	    for (int key; !_quitting && ERR != (key = ScreenKey()); ++nKeys)
+		if (key > 0)
+		    OnKey (key);
+	    // End of input is reported by poll as readable, but yields no
+	    // keys; the read returns 0 as it does when merely drained.
+	    if (!nKeys)
+		_quitting = true;
+	    redraw = true;
+	}
+    }
+}
+
+static void CleanupUI (void)
+{
+    if (_scr.lite)
+	CloseScreen();
+    else
+	endwin();
+    if (_showStats) {
+	_showStats = false;
+	PrintStats();
+    }
+    if (_startup.enabled) {
+	_startup.enabled = false;
+	PrintStartupProfile();
+    }
+    StopScan();
+    StopPrefetch();
+    ReleaseTerminfo (_info);
+    _info = NULL;
+    ClearEntryCache();
+    Free (_watch.changed);
+    _watch.changed = NULL;
+    Free (_layout.width);
+    Free (_layout.firstBreak);
+    Free (_layout.breaks);
+    memset (&_layout, 0, sizeof(_layout));
+    Free (_sorted.row);
+    memset (&_sorted, 0, sizeof(_sorted));
+    FreeHexView();
+    if (_prevalence.h)
+	munmap ((void*) _prevalence.h, _prevalence.size);
+    Free (_prevalence.key.p);
+    memset (&_prevalence, 0, sizeof(_prevalence));
+    Free (_infoBytes);
+    _infoBytes = NULL;
+    _infoBytesSize = 0;
+    _watch.changedRows = 0;
+    for (unsigned i = 0; i < _terms.n; ++i)
+	Free (_terms.name[i]);
+    Free (_terms.name);
+    Free (_terms.keyOffset);
+    Free (_terms.keySize);
+    Free (_terms.keyChars);
+    Free (_terms.keys);
+    memset (&_terms, 0, sizeof(_terms));
+    Free (_filter.match);
+    memset (&_filter, 0, sizeof(_filter));
+}
+
+static void OnQuitSignal (int sig)
+{
+    static bool s_FirstTime = true;
+    if (!s_FirstTime) {
+	psignal (sig, "[S] Double error");
+	_Exit (EXIT_FAILURE);
+    }
+    s_FirstTime = false;
+    CleanupUI();
+    psignal (sig, "[S] Error");
+    exit (EXIT_FAILURE);
+}
+
+static void OnMsgSignal (int sig UNUSED)
+{
+    Draw();
+    ScreenRefresh();
+}
+
+static void InstallCleanupHandlers (void)
+{
+//{{{2 Signal sets for OnQuitSignal and OnMsgSignal
+#define S(sn) (1u<<(sn))
+    enum {
+	sigset_Quit = S(SIGINT)|S(SIGQUIT)|S(SIGTERM)|S(SIGILL)|S(SIGABRT)
+			|S(SIGBUS)|S(SIGFPE)|S(SIGSYS)|S(SIGSEGV)|S(SIGALRM)
+			|S(SIGXCPU),
+	sigset_Msg = S(SIGHUP)|S(SIGCHLD)|S(SIGWINCH)|S(SIGURG)|S(SIGXFSZ)
+			|S(SIGUSR1)|S(SIGUSR2)|S(SIGPIPE)
+    };
+#undef S
+//}}}2
+    atexit (CleanupUI);
+    for (unsigned b = 0; b < NSIG; ++b) {
+	if (sigset_Quit & (1u << b))
+	    signal (b, OnQuitSignal);
+	else if (sigset_Msg & (1u << b))
+	    signal (b, OnMsgSignal);
+    }
+}
+
+static int Usage (void)
+{
+    puts ("Usage: tiedit [-s] [--lite] [termname|-]\n"
+	  "       tiedit -g capname termname|-...\n"
+	  "       tiedit --ext-census [capname]...\n"
+	  "       tiedit --export ndjson|csv [dbdir|-]\n"
+	  "       tiedit --pack db.tia [dbdir]\n"
+	  "       tiedit -A db.tia termname\n"
+	  "       tiedit --snapshot store [dbdir]\n"
+	  "       tiedit --diff-snapshots store snapshot1 snapshot2\n"
+	  "       tiedit --diff-tree dbdir1 dbdir2\n"
+	  "       tiedit --matrix matrix.bin | --clusters maxdistance\n"
+	  "Options: --trace file.json writes a Chrome trace of load, scan, and draw times\n"
+	  "         --lite draws without curses, with the sequences of the $TERM entry\n"
+	  "         --startup-profile shows the first frame, then prints the time to it\n"
+	  "A - reads compiled entries, one or more concatenated, from stdin");
+    return EXIT_SUCCESS;
+}
+
+static void TermFilePath (const char* termname, char* termfile, size_t termfilesz)
+{
+    const uint64_t t = TraceBegin();
+    snprintf (termfile, termfilesz, "%s/%c/%s", TerminfoDbPath(), termname[0], termname);
+    TraceSpan ("resolve path", t, 0);
+}
+
+/// The name queried with -g, and whether any queried entry has it
+struct SQuery {
+    const char*	capname;
+    bool	found;
+};
+
+/// Prints extended value q->capname of tifile, loading the whole entry
+static bool QueryExtValue (const char* tifile, struct SQuery* q)
+{
+    struct STerminfo* ti = AcquireTerminfo (tifile);
+    if (!ti)
+	return false;
+    const unsigned x = FindExtValue (ti, q->capname);
+    if (x != UINT_MAX) {
+	struct SValue v;
+	GetRowValue (ti, NValues+x, &v);
+	PrintValue (&v);
+	q->found = true;
+    }
+    ReleaseTerminfo (ti);
+    return true;
+}
+
+/// Prints the value named capname, or nothing if absent, for an entry read from stdin
+static void QueryStreamEntry (void* ctx, unsigned worker UNUSED, unsigned i, const char* path UNUSED, const struct STerminfo* ti)
+{
+    struct SQuery* q = (struct SQuery*) ctx;
+    if (!ti) {
+	fprintf (stderr, "Error: entry %u on stdin is not a valid terminfo entry\n", i+1);
+	return;
+    }
+    printf ("%.*s: ", (int) strcspn (ti->name, "|"), ti->name);
+    unsigned r = FindValueByName (q->capname);
+    if (r >= NValues && (r = FindExtValue (ti, q->capname)) != UINT_MAX)
+	r += NValues;
+    if (r != UINT_MAX) {
+	struct SValue v;
+	GetRowValue (ti, r, &v);
+	PrintValue (&v);
+	q->found = true;
+    }
+    putchar ('\n');
+}
+
+/// Prints the value named capname for each of the nterms terminals.
+/// Names not in the standard tables are looked up among extended values,
+/// and are an error if no queried entry has them.
+static int QueryMain (const char* capname, int nterms, const char* const* terms)
+{
+    const unsigned r = FindValueByName (capname);
+    struct SQuery q = { capname, r < NValues };
+    int rv = EXIT_SUCCESS;
+    for (int i = 0; i < nterms; ++i) {
+	if (0 == strcmp (terms[i], "-")) {
+	    if (RunStreamScan (STDIN_FILENO, QueryStreamEntry, &q))
+		rv = EXIT_FAILURE;
+	    continue;
+	}
+	char termfile [PATH_MAX];
+	TermFilePath (terms[i], termfile, sizeof(termfile));
+	if (nterms > 1)
+	    printf ("%s: ", terms[i]);
+	fflush (stdout);
+	if (!(r < NValues ? QueryValue (termfile, r) : QueryExtValue (termfile, &q))) {
+	    if (errno)
+		perror (termfile);
+	    else
+		printf ("Error: %s is not a terminfo file\n", termfile);
+	    rv = EXIT_FAILURE;
+	} else
+	    putchar ('\n');
+    }
+    if (!q.found) {
+	printf ("Error: %s is not a capability name\n", capname);
+	rv = EXIT_FAILURE;
+    }
+    return rv;
+}
+
+int main (int argc, const char* const* argv)
+{
+    _startup.start = NowNs();
+    InstallCleanupHandlers();
+    enum {
+	opt_ExtCensus = 256,
+	opt_Export,
+	opt_Pack,
+	opt_Snapshot,
+	opt_DiffSnapshots,
+	opt_DiffTree,
+	opt_Matrix,
+	opt_Clusters,
+	opt_Trace,
+	opt_Lite,
+	opt_StartupProfile
+    };
+    static const struct option c_Options[] = {
+	{ "stats",	no_argument,		NULL,	's' },
+	{ "get",	required_argument,	NULL,	'g' },
+	{ "ext-census",	no_argument,		NULL,	opt_ExtCensus },
+	{ "export",	required_argument,	NULL,	opt_Export },
+	{ "pack",	required_argument,	NULL,	opt_Pack },
+	{ "archive",	required_argument,	NULL,	'A' },
+	{ "snapshot",	required_argument,	NULL,	opt_Snapshot },
+	{ "diff-snapshots", required_argument,	NULL,	opt_DiffSnapshots },
+	{ "diff-tree",	no_argument,		NULL,	opt_DiffTree },
+	{ "matrix",	required_argument,	NULL,	opt_Matrix },
+	{ "clusters",	required_argument,	NULL,	opt_Clusters },
+	{ "trace",	required_argument,	NULL,	opt_Trace },
+	{ "lite",	no_argument,		NULL,	opt_Lite },
+	{ "startup-profile", no_argument,	NULL,	opt_StartupProfile },
+	{ NULL,		0,			NULL,	0 }
+    };
+    const char* query = NULL;
+    const char* exportFormat = NULL;
+    const char* packFile = NULL;
+    const char* archive = NULL;
+    const char* snapshotStore = NULL;
+    const char* diffStore = NULL;
+    bool diffTree = false;
+    const char* matrixFile = NULL;
+    const char* clusters = NULL;
+    bool extCensus = false;
+    for (int opt; 0 < (opt = getopt_long (argc, (char* const*) argv, "sg:A:", c_Options, NULL));) {
+	if (opt == 's')
+	    _showStats = true;
+	else if (opt == 'g')
+	    query = optarg;
+	else if (opt == opt_ExtCensus)
+	    extCensus = true;
+	else if (opt == opt_Export)
+	    exportFormat = optarg;
+	else if (opt == opt_Pack)
+	    packFile = optarg;
+	else if (opt == 'A')
+	    archive = optarg;
+	else if (opt == opt_Snapshot)
+	    snapshotStore = optarg;
+	else if (opt == opt_DiffSnapshots)
+	    diffStore = optarg;
+	else if (opt == opt_DiffTree)
+	    diffTree = true;
+	else if (opt == opt_Matrix)
+	    matrixFile = optarg;
+	else if (opt == opt_Clusters)
+	    clusters = optarg;
+	else if (opt == opt_Lite)
+	    _scr.lite = true;
+	else if (opt == opt_StartupProfile)
+	    _startup.enabled = true;
+	else if (opt == opt_Trace && !_trace.file) {
+	    _trace.file = optarg;
+	    _trace.epoch = NowNs();
+	    atexit (WriteTrace);
+	}
+	else
+	    return Usage();
+    }
+    if (query || extCensus || exportFormat || packFile || snapshotStore || diffStore || diffTree || matrixFile || clusters)
+	signal (SIGPIPE, SIG_DFL);	// Batch output is often piped to a reader that may quit early
+    if (query)
+	return QueryMain (query, argc-optind, argv+optind);
+    if (extCensus)
+	return CensusMain (argv+optind, argc-optind);
+    if (exportFormat && argc <= optind+1)
+	return ExportMain (exportFormat, argc == optind+1 ? argv[optind] : TerminfoDbPath());
+    if (packFile && argc <= optind+1)
+	return PackMain (packFile, argc == optind+1 ? argv[optind] : TerminfoDbPath());
+    if (snapshotStore && argc <= optind+1)
+	return SnapshotMain (snapshotStore, argc == optind+1 ? argv[optind] : TerminfoDbPath());
+    if (diffStore && argc == optind+2)
+	return DiffSnapshotsMain (diffStore, argv[optind], argv[optind+1]);
+    if (diffTree && argc == optind+2)
+	return DiffTreeMain (argv[optind], argv[optind+1]);
+    if (diffStore || diffTree)
+	return Usage();
+    if (matrixFile && clusters) {
+	puts ("Error: --matrix and --clusters can not be used together");
+	return EXIT_FAILURE;
+    }
+    if (matrixFile)
+	return MatrixMain (matrixFile, 0);
+    if (clusters) {
+	char* end;
+	const long maxd = strtol (clusters, &end, 10);
+	if (end == clusters || *end || maxd < 0 || maxd > INT_MAX) {
+	    printf ("Error: %s is not a valid distance\n", clusters);
+	    return EXIT_FAILURE;
+	}
+	return MatrixMain (NULL, maxd);
+    }
+    if (argc > optind+1)
+	return Usage();
+    if (archive && argc != optind+1)
+	return Usage();
+    if (argc == optind+1) {
+	char termfile [PATH_MAX];
+	const bool fromStdin = !archive && 0 == strcmp (argv[optind], "-");
+	if (fromStdin) {
+	    // The first entry on stdin is copied to memory, and the
+	    // terminal is then reopened as stdin for the UI.
+	    if (!(_infoBytes = FirstStreamEntry (STDIN_FILENO, &_infoBytesSize))) {
+		if (errno)
+		    perror ("stdin");
+		else
+		    puts ("Error: stdin is not a terminfo entry");
+		return EXIT_FAILURE;
+	    }
+	    const int tfd = open ("/dev/tty", O_RDONLY);
+	    if (tfd < 0 || 0 > dup2 (tfd, STDIN_FILENO)) {
+		perror ("/dev/tty");
+		return EXIT_FAILURE;
+	    }
+	    close (tfd);
+	    snprintf (termfile, sizeof(termfile), "stdin");
+	} else if (!archive)
+	    TermFilePath (argv[optind], termfile, sizeof(termfile));
+	else {
+	    if (!(_infoBytes = ExtractArchived (archive, argv[optind], &_infoBytesSize))) {
+		if (errno)
+		    perror (archive);
+		else
+		    printf ("Error: %s is not in %s\n", argv[optind], archive);
+		return EXIT_FAILURE;
+	    }
+	    snprintf (termfile, sizeof(termfile), "%s in %s", argv[optind], archive);
+	}
+	// Entries without a file are parsed from memory, and their bytes
+	// are kept for the hex view.
+	_info = _infoBytes ? AcquireTerminfoBytes (_infoBytes, _infoBytesSize) : AcquireTerminfo (termfile);
+	if (!_info) {
+	    if (errno)
+		perror (termfile);
+	    else
+		printf ("Error: %s is not a terminfo file\n", termfile);
+	    Free (_infoBytes);
+	    return EXIT_FAILURE;
+	}
+	if (!_infoBytes) {
+	    snprintf (_infoPath, sizeof(_infoPath), "%s", termfile);
+	    WatchEntryFile (termfile);
+	}
+    } else {
+	// Without a terminal name, show the browser while the database is scanned
+	_view = view_Browser;
+	_browsing = true;
+	StartScan();
+    }
+    StartupMark (startup_Loaded);
+    InitUI();
+    StartupMark (startup_UI);
+    EventLoop();
+    return EXIT_SUCCESS;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Value name tables
+
+// Each standard value, in file order, as
+// _(name, capname, termcap code, description)
+#define BOOLEAN_CAPS(_)\
+    _(auto_left_margin,          "bw",    "bw",  "cub1 wraps from column 0 to last column")\
+    _(auto_right_margin,         "am",    "am",  "terminal has automatic margins")\
+    _(no_esc_ctlc,               "xsb",   "xb",  "beehive (f1=escape, f2=ctrl C)")\
+    _(ceol_standout_glitch,      "xhp",   "xs",  "standout not erased by overwriting (hp)")\
+    _(eat_newline_glitch,        "xenl",  "xn",  "newline ignored after 80 cols (concept)")\
+    _(erase_overstrike,          "eo",    "eo",  "can erase overstrikes with a blank")\
+    _(generic_type,              "gn",    "gn",  "generic line type")\
+    _(hard_copy,                 "hc",    "hc",  "hardcopy terminal")\
+    _(has_meta_key,              "km",    "km",  "Has a meta key (i.e., sets 8th-bit)")\
+    _(has_status_line,           "hs",    "hs",  "has extra status line")\
+    _(insert_null_glitch,        "in",    "in",  "insert mode distinguishes nulls")\
+    _(memory_above,              "da",    "da",  "display may be retained above the screen")\
+    _(memory_below,              "db",    "db",  "display may be retained below the screen")\
+    _(move_insert_mode,          "mir",   "mi",  "safe to move while in insert mode")\
+    _(move_standout_mode,        "msgr",  "ms",  "safe to move while in standout mode")\
+    _(over_strike,               "os",    "os",  "terminal can overstrike")\
+    _(status_line_esc_ok,        "eslok", "es",  "escape can be used on the status line")\
+    _(dest_tabs_magic_smso,      "xt",    "xt",  "tabs destructive, magic so char (t1061)")\
+    _(tilde_glitch,              "hz",    "hz",  "cannot print ~'s (Hazeltine)")\
+    _(transparent_underline,     "ul",    "ul",  "underline character overstrikes")\
+    _(xon_xoff,                  "xon",   "xo",  "terminal uses xon/xoff handshaking")\
+    _(needs_xon_xoff,            "nxon",  "nx",  "padding will not work, xon/xoff required")\
+    _(prtr_silent,               "mc5i",  "5i",  "printer will not echo on screen")\
+    _(hard_cursor,               "chts",  "HC",  "cursor is hard to see")\
+    _(non_rev_rmcup,             "nrrmc", "NR",  "smcup does not reverse rmcup")\
+    _(no_pad_char,               "npc",   "NP",  "pad character does not exist")\
+    _(non_dest_scroll_region,    "ndscr", "ND",  "scrolling region is non-destructive")\
+    _(can_change,                "ccc",   "cc",  "terminal can re-define existing colors")\
+    _(back_color_erase,          "bce",   "ut",  "screen erased with background color")\
+    _(hue_lightness_saturation,  "hls",   "hl",  "terminal uses only HLS color notation (Tektronix)")\
+    _(col_addr_glitch,           "xhpa",  "YA",  "only positive motion for hpa/mhpa caps")\
+    _(cr_cancels_micro_mode,     "crxm",  "YB",  "using cr turns off micro mode")\
+    _(has_print_wheel,           "daisy", "YC",  "printer needs operator to change character set")\
+    _(row_addr_glitch,           "xvpa",  "YD",  "only positive motion for vpa/mvpa caps")\
+    _(semi_auto_right_margin,    "sam",   "YE",  "printing in last column causes cr")\
+    _(cpi_changes_res,           "cpix",  "YF",  "changing character pitch changes resolution")\
+    _(lpi_changes_res,           "lpix",  "YG",  "changing line pitch changes resolution")\
+    _(backspaces_with_bs,        "OTbs",  "bs",  "uses ^H to move left")\
+    _(crt_no_scrolling,          "OTns",  "ns",  "crt cannot scroll")\
+    _(no_correctly_working_cr,   "OTnc",  "nc",  "no way to go to start of line")\
+    _(gnu_has_meta_key,          "OTMT",  "MT",  "has meta key")\
+    _(linefeed_is_newline,       "OTNL",  "NL",  "move down with \\n")\
+    _(has_hardware_tabs,         "OTpt",  "pt",  "has 8-char tabs invoked with ^I")\
+    _(return_does_clr_eol,       "OTxr",  "xr",  "return clears the line")\
+
+#define NUMBER_CAPS(_)\
+    _(columns,                  "cols",  "co",  "number of columns in a line")\
+    _(init_tabs,                "it",    "it",  "tabs initially every # spaces")\
+    _(lines,                    "lines", "li",  "number of lines on screen or page")\
+    _(lines_of_memory,          "lm",    "lm",  "lines of memory if > line. 0 means varies")\
+    _(magic_cookie_glitch,      "xmc",   "sg",  "number of blank characters left by smso or rmso")\
+    _(padding_baud_rate,        "pb",    "pb",  "lowest baud rate where padding needed")\
+    _(virtual_terminal,         "vt",    "vt",  "virtual terminal number (CB/unix)")\
+    _(width_status_line,        "wsl",   "ws",  "number of columns in status line")\
+    _(num_labels,               "nlab",  "Nl",  "number of labels on screen")\
+    _(label_height,             "lh",    "lh",  "rows in each label")\
+    _(label_width,              "lw",    "lw",  "columns in each label")\
+    _(max_attributes,           "ma",    "ma",  "maximum combined attributes terminal can handle")\
+    _(maximum_windows,          "wnum",  "MW",  "maximum number of definable windows")\
+    _(max_colors,               "colors", "Co",  "maximum number of colors on screen")\
+    _(max_pairs,                "pairs", "pa",  "maximum number of color-pairs on the screen")\
+    _(no_color_video,           "ncv",   "NC",  "video attributes that cannot be used with colors")\
+    _(buffer_capacity,          "bufsz", "Ya",  "numbers of bytes buffered before printing")\
+    _(dot_vert_spacing,         "spinv", "Yb",  "spacing of pins vertically in pins per inch")\
+    _(dot_horz_spacing,         "spinh", "Yc",  "spacing of dots horizontally in dots per inch")\
+    _(max_micro_address,        "maddr", "Yd",  "maximum value in micro_..._address")\
+    _(max_micro_jump,           "mjump", "Ye",  "maximum value in parm_..._micro")\
+    _(micro_col_size,           "mcs",   "Yf",  "character step size when in micro mode")\
+    _(micro_line_size,          "mls",   "Yg",  "line step size when in micro mode")\
+    _(number_of_pins,           "npins", "Yh",  "numbers of pins in print-head")\
+    _(output_res_char,          "orc",   "Yi",  "horizontal resolution in units per line")\
+    _(output_res_line,          "orl",   "Yj",  "vertical resolution in units per line")\
+    _(output_res_horz_inch,     "orhi",  "Yk",  "horizontal resolution in units per inch")\
+    _(output_res_vert_inch,     "orvi",  "Yl",  "vertical resolution in units per inch")\
+    _(print_rate,               "cps",   "Ym",  "print rate in characters per second")\
+    _(wide_char_size,           "widcs", "Yn",  "character step size when in double wide mode")\
+    _(buttons,                  "btns",  "BT",  "number of buttons on mouse")\
+    _(bit_image_entwining,      "bitwin", "Yo",  "number of passes for each bit-image row")\
+    _(bit_image_type,           "bitype", "Yp",  "type of bit-image device")\
+    _(magic_cookie_glitch_ul,   "OTug",  "ug",  "number of blanks left by ul")\
+    _(carriage_return_delay,    "OTdC",  "dC",  "pad needed for CR")\
+    _(new_line_delay,           "OTdN",  "dN",  "pad needed for LF")\
+    _(backspace_delay,          "OTdB",  "dB",  "padding required for ^H")\
+    _(horizontal_tab_delay,     "OTdT",  "dT",  "padding required for ^I")\
+    _(number_of_function_keys,  "OTkn",  "kn",  "count of function keys")\
+
+#define STRING_CAPS(_)\
+    _(back_tab,                   "cbt",   "bt",  "back tab (P)")\
+    _(bell,                       "bel",   "bl",  "audible signal (bell) (P)")\
+    _(carriage_return,            "cr",    "cr",  "carriage return (P*) (P*)")\
+    _(change_scroll_region,       "csr",   "cs",  "change region to line #1 to line #2 (P)")\
+    _(clear_all_tabs,             "tbc",   "ct",  "clear all tab stops (P)")\
+    _(clear_screen,               "clear", "cl",  "clear screen and home cursor (P*)")\
+    _(clr_eol,                    "el",    "ce",  "clear to end of line (P)")\
+    _(clr_eos,                    "ed",    "cd",  "clear to end of screen (P*)")\
+    _(column_address,             "hpa",   "ch",  "horizontal position #1, absolute (P)")\
+    _(command_character,          "cmdch", "CC",  "terminal settable cmd character in prototype !?")\
+    _(cursor_address,             "cup",   "cm",  "move to row #1 columns #2")\
+    _(cursor_down,                "cud1",  "do",  "down one line")\
+    _(cursor_home,                "home",  "ho",  "home cursor (if no cup)")\
+    _(cursor_invisible,           "civis", "vi",  "make cursor invisible")\
+    _(cursor_left,                "cub1",  "le",  "move left one space")\
+    _(cursor_mem_address,         "mrcup", "CM",  "memory relative cursor addressing, move to row #1 columns #2")\
+    _(cursor_normal,              "cnorm", "ve",  "make cursor appear normal (undo civis/cvvis)")\
+    _(cursor_right,               "cuf1",  "nd",  "non-destructive space (move right one space)")\
+    _(cursor_to_ll,               "ll",    "ll",  "last line, first column (if no cup)")\
+    _(cursor_up,                  "cuu1",  "up",  "up one line")\
+    _(cursor_visible,             "cvvis", "vs",  "make cursor very visible")\
+    _(delete_character,           "dch1",  "dc",  "delete character (P*)")\
+    _(delete_line,                "dl1",   "dl",  "delete line (P*)")\
+    _(dis_status_line,            "dsl",   "ds",  "disable status line")\
+    _(down_half_line,             "hd",    "hd",  "half a line down")\
+    _(enter_alt_charset_mode,     "smacs", "as",  "start alternate character set (P)")\
+    _(enter_blink_mode,           "blink", "mb",  "turn on blinking")\
+    _(enter_bold_mode,            "bold",  "md",  "turn on bold (extra bright) mode")\
+    _(enter_ca_mode,              "smcup", "ti",  "string to start programs using cup")\
+    _(enter_delete_mode,          "smdc",  "dm",  "enter delete mode")\
+    _(enter_dim_mode,             "dim",   "mh",  "turn on half-bright mode")\
+    _(enter_insert_mode,          "smir",  "im",  "enter insert mode")\
+    _(enter_secure_mode,          "invis", "mk",  "turn on blank mode (characters invisible)")\
+    _(enter_protected_mode,       "prot",  "mp",  "turn on protected mode")\
+    _(enter_reverse_mode,         "rev",   "mr",  "turn on reverse video mode")\
+    _(enter_standout_mode,        "smso",  "so",  "begin standout mode")\
+    _(enter_underline_mode,       "smul",  "us",  "begin underline mode")\
+    _(erase_chars,                "ech",   "ec",  "erase #1 characters (P)")\
+    _(exit_alt_charset_mode,      "rmacs", "ae",  "end alternate character set (P)")\
+    _(exit_attribute_mode,        "sgr0",  "me",  "turn off all attributes")\
+    _(exit_ca_mode,               "rmcup", "te",  "strings to end programs using cup")\
+    _(exit_delete_mode,           "rmdc",  "ed",  "end delete mode")\
+    _(exit_insert_mode,           "rmir",  "ei",  "exit insert mode")\
+    _(exit_standout_mode,         "rmso",  "se",  "exit standout mode")\
+    _(exit_underline_mode,        "rmul",  "ue",  "exit underline mode")\
+    _(flash_screen,               "flash", "vb",  "visible bell (may not move cursor)")\
+    _(form_feed,                  "ff",    "ff",  "hardcopy terminal page eject (P*)")\
+    _(from_status_line,           "fsl",   "fs",  "return from status line")\
+    _(init_1string,               "is1",   "i1",  "initialization string")\
+    _(init_2string,               "is2",   "is",  "initialization string")\
+    _(init_3string,               "is3",   "i3",  "initialization string")\
+    _(init_file,                  "if",    "if",  "name of initialization file")\
+    _(insert_character,           "ich1",  "ic",  "insert character (P)")\
+    _(insert_line,                "il1",   "al",  "insert line (P*)")\
+    _(insert_padding,             "ip",    "ip",  "insert padding after inserted character")\
+    _(key_backspace,              "kbs",   "kb",  "backspace key")\
+    _(key_catab,                  "ktbc",  "ka",  "clear-all-tabs key")\
+    _(key_clear,                  "kclr",  "kC",  "clear-screen or erase key")\
+    _(key_ctab,                   "kctab", "kt",  "clear-tab key")\
+    _(key_dc,                     "kdch1", "kD",  "delete-character key")\
+    _(key_dl,                     "kdl1",  "kL",  "delete-line key")\
+    _(key_down,                   "kcud1", "kd",  "down-arrow key")\
+    _(key_eic,                    "krmir", "kM",  "sent by rmir or smir in insert mode")\
+    _(key_eol,                    "kel",   "kE",  "clear-to-end-of-line key")\
+    _(key_eos,                    "ked",   "kS",  "clear-to-end-of-screen key")\
+    _(key_f0,                     "kf0",   "k0",  "F0 function key")\
+    _(key_f1,                     "kf1",   "k1",  "F1 function key")\
+    _(key_f10,                    "kf10",  "k;",  "F10 function key")\
+    _(key_f2,                     "kf2",   "k2",  "F2 function key")\
+    _(key_f3,                     "kf3",   "k3",  "F3 function key")\
+    _(key_f4,                     "kf4",   "k4",  "F4 function key")\
+    _(key_f5,                     "kf5",   "k5",  "F5 function key")\
+    _(key_f6,                     "kf6",   "k6",  "F6 function key")\
+    _(key_f7,                     "kf7",   "k7",  "F7 function key")\
+    _(key_f8,                     "kf8",   "k8",  "F8 function key")\
+    _(key_f9,                     "kf9",   "k9",  "F9 function key")\
+    _(key_home,                   "khome", "kh",  "home key")\
+    _(key_ic,                     "kich1", "kI",  "insert-character key")\
+    _(key_il,                     "kil1",  "kA",  "insert-line key")\
+    _(key_left,                   "kcub1", "kl",  "left-arrow key")\
+    _(key_ll,                     "kll",   "kH",  "lower-left key (home down)")\
+    _(key_npage,                  "knp",   "kN",  "next-page key")\
+    _(key_ppage,                  "kpp",   "kP",  "previous-page key")\
+    _(key_right,                  "kcuf1", "kr",  "right-arrow key")\
+    _(key_sf,                     "kind",  "kF",  "scroll-forward key")\
+    _(key_sr,                     "kri",   "kR",  "scroll-backward key")\
+    _(key_stab,                   "khts",  "kT",  "set-tab key")\
+    _(key_up,                     "kcuu1", "ku",  "up-arrow key")\
+    _(keypad_local,               "rmkx",  "ke",  "leave 'keyboard_transmit' mode")\
+    _(keypad_xmit,                "smkx",  "ks",  "enter 'keyboard_transmit' mode")\
+    _(lab_f0,                     "lf0",   "l0",  "label on function key f0 if not f0")\
+    _(lab_f1,                     "lf1",   "l1",  "label on function key f1 if not f1")\
+    _(lab_f10,                    "lf10",  "la",  "label on function key f10 if not f10")\
+    _(lab_f2,                     "lf2",   "l2",  "label on function key f2 if not f2")\
+    _(lab_f3,                     "lf3",   "l3",  "label on function key f3 if not f3")\
+    _(lab_f4,                     "lf4",   "l4",  "label on function key f4 if not f4")\
+    _(lab_f5,                     "lf5",   "l5",  "label on function key f5 if not f5")\
+    _(lab_f6,                     "lf6",   "l6",  "label on function key f6 if not f6")\
+    _(lab_f7,                     "lf7",   "l7",  "label on function key f7 if not f7")\
+    _(lab_f8,                     "lf8",   "l8",  "label on function key f8 if not f8")\
+    _(lab_f9,                     "lf9",   "l9",  "label on function key f9 if not f9")\
+    _(meta_off,                   "rmm",   "mo",  "turn off meta mode")\
+    _(meta_on,                    "smm",   "mm",  "turn on meta mode (8th-bit on)")\
+    _(newline,                    "nel",   "nw",  "newline (behave like cr followed by lf)")\
+    _(pad_char,                   "pad",   "pc",  "padding char (instead of null)")\
+    _(parm_dch,                   "dch",   "DC",  "delete #1 characters (P*)")\
+    _(parm_delete_line,           "dl",    "DL",  "delete #1 lines (P*)")\
+    _(parm_down_cursor,           "cud",   "DO",  "down #1 lines (P*)")\
+    _(parm_ich,                   "ich",   "IC",  "insert #1 characters (P*)")\
+    _(parm_index,                 "indn",  "SF",  "scroll forward #1 lines (P)")\
+    _(parm_insert_line,           "il",    "AL",  "insert #1 lines (P*)")\
+    _(parm_left_cursor,           "cub",   "LE",  "move #1 characters to the left (P)")\
+    _(parm_right_cursor,          "cuf",   "RI",  "move #1 characters to the right (P*)")\
+    _(parm_rindex,                "rin",   "SR",  "scroll back #1 lines (P)")\
+    _(parm_up_cursor,             "cuu",   "UP",  "up #1 lines (P*)")\
+    _(pkey_key,                   "pfkey", "pk",  "program function key #1 to type string #2")\
+    _(pkey_local,                 "pfloc", "pl",  "program function key #1 to execute string #2")\
+    _(pkey_xmit,                  "pfx",   "px",  "program function key #1 to transmit string #2")\
+    _(print_screen,               "mc0",   "ps",  "print contents of screen")\
+    _(prtr_off,                   "mc4",   "pf",  "turn off printer")\
+    _(prtr_on,                    "mc5",   "po",  "turn on printer")\
+    _(repeat_char,                "rep",   "rp",  "repeat char #1 #2 times (P*)")\
+    _(reset_1string,              "rs1",   "r1",  "reset string")\
+    _(reset_2string,              "rs2",   "r2",  "reset string")\
+    _(reset_3string,              "rs3",   "r3",  "reset string")\
+    _(reset_file,                 "rf",    "rf",  "name of reset file")\
+    _(restore_cursor,             "rc",    "rc",  "restore cursor to position of last save_cursor")\
+    _(row_address,                "vpa",   "cv",  "vertical position #1 absolute (P)")\
+    _(save_cursor,                "sc",    "sc",  "save current cursor position (P)")\
+    _(scroll_forward,             "ind",   "sf",  "scroll text up (P)")\
+    _(scroll_reverse,             "ri",    "sr",  "scroll text down (P)")\
+    _(set_attributes,             "sgr",   "sa",  "define video attributes #1-#9 (PG9)")\
+    _(set_tab,                    "hts",   "st",  "set a tab in every row, current columns")\
+    _(set_window,                 "wind",  "wi",  "current window is lines #1-#2 cols #3-#4")\
+    _(tab,                        "ht",    "ta",  "tab to next 8-space hardware tab stop")\
+    _(to_status_line,             "tsl",   "ts",  "move to status line, column #1")\
+    _(underline_char,             "uc",    "uc",  "underline char and move past it")\
+    _(up_half_line,               "hu",    "hu",  "half a line up")\
+    _(init_prog,                  "iprog", "iP",  "path name of program for initialization")\
+    _(key_a1,                     "ka1",   "K1",  "upper left of keypad")\
+    _(key_a3,                     "ka3",   "K3",  "upper right of keypad")\
+    _(key_b2,                     "kb2",   "K2",  "center of keypad")\
+    _(key_c1,                     "kc1",   "K4",  "lower left of keypad")\
+    _(key_c3,                     "kc3",   "K5",  "lower right of keypad")\
+    _(prtr_non,                   "mc5p",  "pO",  "turn on printer for #1 bytes")\
+    _(char_padding,               "rmp",   "rP",  "like ip but when in insert mode")\
+    _(acs_chars,                  "acsc",  "ac",  "graphics charset pairs, based on vt100")\
+    _(plab_norm,                  "pln",   "pn",  "program label #1 to show string #2")\
+    _(key_btab,                   "kcbt",  "kB",  "back-tab key")\
+    _(enter_xon_mode,             "smxon", "SX",  "turn on xon/xoff handshaking")\
+    _(exit_xon_mode,              "rmxon", "RX",  "turn off xon/xoff handshaking")\
+    _(enter_am_mode,              "smam",  "SA",  "turn on automatic margins")\
+    _(exit_am_mode,               "rmam",  "RA",  "turn off automatic margins")\
+    _(xon_character,              "xonc",  "XN",  "XON character")\
+    _(xoff_character,             "xoffc", "XF",  "XOFF character")\
+    _(ena_acs,                    "enacs", "eA",  "enable alternate char set")\
+    _(label_on,                   "smln",  "LO",  "turn on soft labels")\
+    _(label_off,                  "rmln",  "LF",  "turn off soft labels")\
+    _(key_beg,                    "kbeg",  "@1",  "begin key")\
+    _(key_cancel,                 "kcan",  "@2",  "cancel key")\
+    _(key_close,                  "kclo",  "@3",  "close key")\
+    _(key_command,                "kcmd",  "@4",  "command key")\
+    _(key_copy,                   "kcpy",  "@5",  "copy key")\
+    _(key_create,                 "kcrt",  "@6",  "create key")\
+    _(key_end,                    "kend",  "@7",  "end key")\
+    _(key_enter,                  "kent",  "@8",  "enter/send key")\
+    _(key_exit,                   "kext",  "@9",  "exit key")\
+    _(key_find,                   "kfnd",  "@0",  "find key")\
+    _(key_help,                   "khlp",  "%1",  "help key")\
+    _(key_mark,                   "kmrk",  "%2",  "mark key")\
+    _(key_message,                "kmsg",  "%3",  "message key")\
+    _(key_move,                   "kmov",  "%4",  "move key")\
+    _(key_next,                   "knxt",  "%5",  "next key")\
+    _(key_open,                   "kopn",  "%6",  "open key")\
+    _(key_options,                "kopt",  "%7",  "options key")\
+    _(key_previous,               "kprv",  "%8",  "previous key")\
+    _(key_print,                  "kprt",  "%9",  "print key")\
+    _(key_redo,                   "krdo",  "%0",  "redo key")\
+    _(key_reference,              "kref",  "&1",  "reference key")\
+    _(key_refresh,                "krfr",  "&2",  "refresh key")\
+    _(key_replace,                "krpl",  "&3",  "replace key")\
+    _(key_restart,                "krst",  "&4",  "restart key")\
+    _(key_resume,                 "kres",  "&5",  "resume key")\
+    _(key_save,                   "ksav",  "&6",  "save key")\
+    _(key_suspend,                "kspd",  "&7",  "suspend key")\
+    _(key_undo,                   "kund",  "&8",  "undo key")\
+    _(key_sbeg,                   "kBEG",  "&9",  "shifted begin key")\
+    _(key_scancel,                "kCAN",  "&0",  "shifted cancel key")\
+    _(key_scommand,               "kCMD",  "*1",  "shifted command key")\
+    _(key_scopy,                  "kCPY",  "*2",  "shifted copy key")\
+    _(key_screate,                "kCRT",  "*3",  "shifted create key")\
+    _(key_sdc,                    "kDC",   "*4",  "shifted delete-character key")\
+    _(key_sdl,                    "kDL",   "*5",  "shifted delete-line key")\
+    _(key_select,                 "kslt",  "*6",  "select key")\
+    _(key_send,                   "kEND",  "*7",  "shifted end key")\
+    _(key_seol,                   "kEOL",  "*8",  "shifted clear-to-end-of-line key")\
+    _(key_sexit,                  "kEXT",  "*9",  "shifted exit key")\
+    _(key_sfind,                  "kFND",  "*0",  "shifted find key")\
+    _(key_shelp,                  "kHLP",  "#1",  "shifted help key")\
+    _(key_shome,                  "kHOM",  "#2",  "shifted home key")\
+    _(key_sic,                    "kIC",   "#3",  "shifted insert-character key")\
+    _(key_sleft,                  "kLFT",  "#4",  "shifted left-arrow key")\
+    _(key_smessage,               "kMSG",  "%a",  "shifted message key")\
+    _(key_smove,                  "kMOV",  "%b",  "shifted move key")\
+    _(key_snext,                  "kNXT",  "%c",  "shifted next key")\
+    _(key_soptions,               "kOPT",  "%d",  "shifted options key")\
+    _(key_sprevious,              "kPRV",  "%e",  "shifted previous key")\
+    _(key_sprint,                 "kPRT",  "%f",  "shifted print key")\
+    _(key_sredo,                  "kRDO",  "%g",  "shifted redo key")\
+    _(key_sreplace,               "kRPL",  "%h",  "shifted replace key")\
+    _(key_sright,                 "kRIT",  "%i",  "shifted right-arrow key")\
+    _(key_srsume,                 "kRES",  "%j",  "shifted resume key")\
+    _(key_ssave,                  "kSAV",  "!1",  "shifted save key")\
+    _(key_ssuspend,               "kSPD",  "!2",  "shifted suspend key")\
+    _(key_sundo,                  "kUND",  "!3",  "shifted undo key")\
+    _(req_for_input,              "rfi",   "RF",  "send next input char (for ptys)")\
+    _(key_f11,                    "kf11",  "F1",  "F11 function key")\
+    _(key_f12,                    "kf12",  "F2",  "F12 function key")\
+    _(key_f13,                    "kf13",  "F3",  "F13 function key")\
+    _(key_f14,                    "kf14",  "F4",  "F14 function key")\
+    _(key_f15,                    "kf15",  "F5",  "F15 function key")\
+    _(key_f16,                    "kf16",  "F6",  "F16 function key")\
+    _(key_f17,                    "kf17",  "F7",  "F17 function key")\
+    _(key_f18,                    "kf18",  "F8",  "F18 function key")\
+    _(key_f19,                    "kf19",  "F9",  "F19 function key")\
+    _(key_f20,                    "kf20",  "FA",  "F20 function key")\
+    _(key_f21,                    "kf21",  "FB",  "F21 function key")\
+    _(key_f22,                    "kf22",  "FC",  "F22 function key")\
+    _(key_f23,                    "kf23",  "FD",  "F23 function key")\
+    _(key_f24,                    "kf24",  "FE",  "F24 function key")\
+    _(key_f25,                    "kf25",  "FF",  "F25 function key")\
+    _(key_f26,                    "kf26",  "FG",  "F26 function key")\
+    _(key_f27,                    "kf27",  "FH",  "F27 function key")\
+    _(key_f28,                    "kf28",  "FI",  "F28 function key")\
+    _(key_f29,                    "kf29",  "FJ",  "F29 function key")\
+    _(key_f30,                    "kf30",  "FK",  "F30 function key")\
+    _(key_f31,                    "kf31",  "FL",  "F31 function key")\
+    _(key_f32,                    "kf32",  "FM",  "F32 function key")\
+    _(key_f33,                    "kf33",  "FN",  "F33 function key")\
+    _(key_f34,                    "kf34",  "FO",  "F34 function key")\
+    _(key_f35,                    "kf35",  "FP",  "F35 function key")\
+    _(key_f36,                    "kf36",  "FQ",  "F36 function key")\
+    _(key_f37,                    "kf37",  "FR",  "F37 function key")\
+    _(key_f38,                    "kf38",  "FS",  "F38 function key")\
+    _(key_f39,                    "kf39",  "FT",  "F39 function key")\
+    _(key_f40,                    "kf40",  "FU",  "F40 function key")\
+    _(key_f41,                    "kf41",  "FV",  "F41 function key")\
+    _(key_f42,                    "kf42",  "FW",  "F42 function key")\
+    _(key_f43,                    "kf43",  "FX",  "F43 function key")\
+    _(key_f44,                    "kf44",  "FY",  "F44 function key")\
+    _(key_f45,                    "kf45",  "FZ",  "F45 function key")\
+    _(key_f46,                    "kf46",  "Fa",  "F46 function key")\
+    _(key_f47,                    "kf47",  "Fb",  "F47 function key")\
+    _(key_f48,                    "kf48",  "Fc",  "F48 function key")\
+    _(key_f49,                    "kf49",  "Fd",  "F49 function key")\
+    _(key_f50,                    "kf50",  "Fe",  "F50 function key")\
+    _(key_f51,                    "kf51",  "Ff",  "F51 function key")\
+    _(key_f52,                    "kf52",  "Fg",  "F52 function key")\
+    _(key_f53,                    "kf53",  "Fh",  "F53 function key")\
+    _(key_f54,                    "kf54",  "Fi",  "F54 function key")\
+    _(key_f55,                    "kf55",  "Fj",  "F55 function key")\
+    _(key_f56,                    "kf56",  "Fk",  "F56 function key")\
+    _(key_f57,                    "kf57",  "Fl",  "F57 function key")\
+    _(key_f58,                    "kf58",  "Fm",  "F58 function key")\
+    _(key_f59,                    "kf59",  "Fn",  "F59 function key")\
+    _(key_f60,                    "kf60",  "Fo",  "F60 function key")\
+    _(key_f61,                    "kf61",  "Fp",  "F61 function key")\
+    _(key_f62,                    "kf62",  "Fq",  "F62 function key")\
+    _(key_f63,                    "kf63",  "Fr",  "F63 function key")\
+    _(clr_bol,                    "el1",   "cb",  "Clear to beginning of line")\
+    _(clear_margins,              "mgc",   "MC",  "clear right and left soft margins")\
+    _(set_left_margin,            "smgl",  "ML",  "set left soft margin at current column. (ML is not in BSD termcap).")\
+    _(set_right_margin,           "smgr",  "MR",  "set right soft margin at current column")\
+    _(label_format,               "fln",   "Lf",  "label format")\
+    _(set_clock,                  "sclk",  "SC",  "set clock, #1 hrs #2 mins #3 secs")\
+    _(display_clock,              "dclk",  "DK",  "display clock")\
+    _(remove_clock,               "rmclk", "RC",  "remove clock")\
+    _(create_window,              "cwin",  "CW",  "define a window #1 from #2,#3 to #4,#5")\
+    _(goto_window,                "wingo", "WG",  "go to window #1")\
+    _(hangup,                     "hup",   "HU",  "hang-up phone")\
+    _(dial_phone,                 "dial",  "DI",  "dial number #1")\
+    _(quick_dial,                 "qdial", "QD",  "dial number #1 without checking")\
+    _(tone,                       "tone",  "TO",  "select touch tone dialing")\
+    _(pulse,                      "pulse", "PU",  "select pulse dialing")\
+    _(flash_hook,                 "hook",  "fh",  "flash switch hook")\
+    _(fixed_pause,                "pause", "PA",  "pause for 2-3 seconds")\
+    _(wait_tone,                  "wait",  "WA",  "wait for dial-tone")\
+    _(user0,                      "u0",    "u0",  "User string #0")\
+    _(user1,                      "u1",    "u1",  "User string #1")\
+    _(user2,                      "u2",    "u2",  "User string #2")\
+    _(user3,                      "u3",    "u3",  "User string #3")\
+    _(user4,                      "u4",    "u4",  "User string #4")\
+    _(user5,                      "u5",    "u5",  "User string #5")\
+    _(user6,                      "u6",    "u6",  "User string #6")\
+    _(user7,                      "u7",    "u7",  "User string #7")\
+    _(user8,                      "u8",    "u8",  "User string #8")\
+    _(user9,                      "u9",    "u9",  "User string #9")\
+    _(orig_pair,                  "op",    "op",  "Set default pair to its original value")\
+    _(orig_colors,                "oc",    "oc",  "Set all color pairs to the original ones")\
+    _(initialize_color,           "initc", "Ic",  "initialize color #1 to (#2,#3,#4)")\
+    _(initialize_pair,            "initp", "Ip",  "Initialize color pair #1 to fg=(#2,#3,#4), bg=(#5,#6,#7)")\
+    _(set_color_pair,             "scp",   "sp",  "Set current color pair to #1")\
+    _(set_foreground,             "setf",  "Sf",  "Set foreground color #1")\
+    _(set_background,             "setb",  "Sb",  "Set background color #1")\
+    _(change_char_pitch,          "cpi",   "ZA",  "Change number of characters per inch to #1")\
+    _(change_line_pitch,          "lpi",   "ZB",  "Change number of lines per inch to #1")\
+    _(change_res_horz,            "chr",   "ZC",  "Change horizontal resolution to #1")\
+    _(change_res_vert,            "cvr",   "ZD",  "Change vertical resolution to #1")\
+    _(define_char,                "defc",  "ZE",  "Define a character #1, #2 dots wide, descender #3")\
+    _(enter_doublewide_mode,      "swidm", "ZF",  "Enter double-wide mode")\
+    _(enter_draft_quality,        "sdrfq", "ZG",  "Enter draft-quality mode")\
+    _(enter_italics_mode,         "sitm",  "ZH",  "Enter italic mode")\
+    _(enter_leftward_mode,        "slm",   "ZI",  "Start leftward carriage motion")\
+    _(enter_micro_mode,           "smicm", "ZJ",  "Start micro-motion mode")\
+    _(enter_near_letter_quality,  "snlq",  "ZK",  "Enter NLQ mode")\
+    _(enter_normal_quality,       "snrmq", "ZL",  "Enter normal-quality mode")\
+    _(enter_shadow_mode,          "sshm",  "ZM",  "Enter shadow-print mode")\
+    _(enter_subscript_mode,       "ssubm", "ZN",  "Enter subscript mode")\
+    _(enter_superscript_mode,     "ssupm", "ZO",  "Enter superscript mode")\
+    _(enter_upward_mode,          "sum",   "ZP",  "Start upward carriage motion")\
+    _(exit_doublewide_mode,       "rwidm", "ZQ",  "End double-wide mode")\
+    _(exit_italics_mode,          "ritm",  "ZR",  "End italic mode")\
+    _(exit_leftward_mode,         "rlm",   "ZS",  "End left-motion mode")\
+    _(exit_micro_mode,            "rmicm", "ZT",  "End micro-motion mode")\
+    _(exit_shadow_mode,           "rshm",  "ZU",  "End shadow-print mode")\
+    _(exit_subscript_mode,        "rsubm", "ZV",  "End subscript mode")\
+    _(exit_superscript_mode,      "rsupm", "ZW",  "End superscript mode")\
+    _(exit_upward_mode,           "rum",   "ZX",  "End reverse character motion")\
+    _(micro_column_address,       "mhpa",  "ZY",  "Like column_address in micro mode")\
+    _(micro_down,                 "mcud1", "ZZ",  "Like cursor_down in micro mode")\
+    _(micro_left,                 "mcub1", "Za",  "Like cursor_left in micro mode")\
+    _(micro_right,                "mcuf1", "Zb",  "Like cursor_right in micro mode")\
+    _(micro_row_address,          "mvpa",  "Zc",  "Like row_address #1 in micro mode")\
+    _(micro_up,                   "mcuu1", "Zd",  "Like cursor_up in micro mode")\
+    _(order_of_pins,              "porder", "Ze",  "Match software bits to print-head pins")\
+    _(parm_down_micro,            "mcud",  "Zf",  "Like parm_down_cursor in micro mode")\
+    _(parm_left_micro,            "mcub",  "Zg",  "Like parm_left_cursor in micro mode")\
+    _(parm_right_micro,           "mcuf",  "Zh",  "Like parm_right_cursor in micro mode")\
+    _(parm_up_micro,              "mcuu",  "Zi",  "Like parm_up_cursor in micro mode")\
+    _(select_char_set,            "scs",   "Zj",  "Select character set, #1")\
+    _(set_bottom_margin,          "smgb",  "Zk",  "Set bottom margin at current line")\
+    _(set_bottom_margin_parm,     "smgbp", "Zl",  "Set bottom margin at line #1 or (if smgtp is not given) #2 lines from bottom")\
+    _(set_left_margin_parm,       "smglp", "Zm",  "Set left (right) margin at column #1")\
+    _(set_right_margin_parm,      "smgrp", "Zn",  "Set right margin at column #1")\
+    _(set_top_margin,             "smgt",  "Zo",  "Set top margin at current line")\
+    _(set_top_margin_parm,        "smgtp", "Zp",  "Set top (bottom) margin at row #1")\
+    _(start_bit_image,            "sbim",  "Zq",  "Start printing bit image graphics")\
+    _(start_char_set_def,         "scsd",  "Zr",  "Start character set definition #1, with #2 characters in the set")\
+    _(stop_bit_image,             "rbim",  "Zs",  "Stop printing bit image graphics")\
+    _(stop_char_set_def,          "rcsd",  "Zt",  "End definition of character set #1")\
+    _(subscript_characters,       "subcs", "Zu",  "List of subscriptable characters")\
+    _(superscript_characters,     "supcs", "Zv",  "List of superscriptable characters")\
+    _(these_cause_cr,             "docr",  "Zw",  "Printing any of these characters causes CR")\
+    _(zero_motion,                "zerom", "Zx",  "No motion for subsequent character")\
+    _(char_set_names,             "csnm",  "Zy",  "Produce #1'th item from list of character set names")\
+    _(key_mouse,                  "kmous", "Km",  "Mouse event has occurred")\
+    _(mouse_info,                 "minfo", "Mi",  "Mouse status information")\
+    _(req_mouse_pos,              "reqmp", "RQ",  "Request mouse position")\
+    _(get_mouse,                  "getm",  "Gm",  "Curses should get button events, parameter #1 not documented.")\
+    _(set_a_foreground,           "setaf", "AF",  "Set foreground color to #1, using ANSI escape")\
+    _(set_a_background,           "setab", "AB",  "Set background color to #1, using ANSI escape")\
+    _(pkey_plab,                  "pfxl",  "xl",  "Program function key #1 to type string #2 and show string #3")\
+    _(device_type,                "devt",  "dv",  "Indicate language/codeset support")\
+    _(code_set_init,              "csin",  "ci",  "Init sequence for multiple codesets")\
+    _(set0_des_seq,               "s0ds",  "s0",  "Shift to codeset 0 (EUC set 0, ASCII)")\
+    _(set1_des_seq,               "s1ds",  "s1",  "Shift to codeset 1")\
+    _(set2_des_seq,               "s2ds",  "s2",  "Shift to codeset 2")\
+    _(set3_des_seq,               "s3ds",  "s3",  "Shift to codeset 3")\
+    _(set_lr_margin,              "smglr", "ML",  "Set both left and right margins to #1, #2. (ML is not in BSD termcap).")\
+    _(set_tb_margin,              "smgtb", "MT",  "Sets both top and bottom margins to #1, #2")\
+    _(bit_image_repeat,           "birep", "Xy",  "Repeat bit image cell #1 #2 times")\
+    _(bit_image_newline,          "binel", "Zz",  "Move to next row of the bit image")\
+    _(bit_image_carriage_return,  "bicr",  "Yv",  "Move to beginning of same row")\
+    _(color_names,                "colornm", "Yw",  "Give name for color #1")\
+    _(define_bit_image_region,    "defbi", "Yx",  "Define rectangular bit image region")\
+    _(end_bit_image_region,       "endbi", "Yy",  "End a bit-image region")\
+    _(set_color_band,             "setcolor", "Yz",  "Change to ribbon color #1")\
+    _(set_page_length,            "slines", "YZ",  "Set page length to #1 lines")\
+    _(display_pc_char,            "dispc", "S1",  "Display PC character #1")\
+    _(enter_pc_charset_mode,      "smpch", "S2",  "Enter PC character display mode")\
+    _(exit_pc_charset_mode,       "rmpch", "S3",  "Exit PC character display mode")\
+    _(enter_scancode_mode,        "smsc",  "S4",  "Enter PC scancode mode")\
+    _(exit_scancode_mode,         "rmsc",  "S5",  "Exit PC scancode mode")\
+    _(pc_term_options,            "pctrm", "S6",  "PC terminal options")\
+    _(scancode_escape,            "scesc", "S7",  "Escape for scancode emulation")\
+    _(alt_scancode_esc,           "scesa", "S8",  "Alternate escape for scancode emulation")\
+    _(enter_horizontal_hl_mode,   "ehhlm", "Xh",  "Enter horizontal highlight mode")\
+    _(enter_left_hl_mode,         "elhlm", "Xl",  "Enter left highlight mode")\
+    _(enter_low_hl_mode,          "elohlm", "Xo",  "Enter low highlight mode")\
+    _(enter_right_hl_mode,        "erhlm", "Xr",  "Enter right highlight mode")\
+    _(enter_top_hl_mode,          "ethlm", "Xt",  "Enter top highlight mode")\
+    _(enter_vertical_hl_mode,     "evhlm", "Xv",  "Enter vertical highlight mode")\
+    _(set_a_attributes,           "sgr1",  "sA",  "Define second set of video attributes #1-#6")\
+    _(set_pglen_inch,             "slength", "YI",  "Set page length to #1 hundredth of an inch (some implementations use sL for termcap).")\
+    _(termcap_init2,              "OTi2",  "i2",  "secondary initialization string")\
+    _(termcap_reset,              "OTrs",  "rs",  "terminal reset string")\
+    _(linefeed_if_not_lf,         "OTnl",  "nl",  "use to move down")\
+    _(backspace_if_not_bs,        "OTbc",  "bc",  "move left, if not ^H")\
+    _(other_non_function_keys,    "OTko",  "ko",  "list of self-mapped keycaps")\
+    _(arrow_key_map,              "OTma",  "ma",  "map motion-keys for vi version 2")\
+    _(acs_ulcorner,               "OTG2",  "G2",  "single upper left")\
+    _(acs_llcorner,               "OTG3",  "G3",  "single lower left")\
+    _(acs_urcorner,               "OTG1",  "G1",  "single upper right")\
+    _(acs_lrcorner,               "OTG4",  "G4",  "single lower right")\
+    _(acs_ltee,                   "OTGR",  "GR",  "tee pointing right")\
+    _(acs_rtee,                   "OTGL",  "GL",  "tee pointing left")\
+    _(acs_btee,                   "OTGU",  "GU",  "tee pointing up")\
+    _(acs_ttee,                   "OTGD",  "GD",  "tee pointing down")\
+    _(acs_hline,                  "OTGH",  "GH",  "single horizontal line")\
+    _(acs_vline,                  "OTGV",  "GV",  "single vertical line")\
+    _(acs_plus,                   "OTGC",  "GC",  "single intersection")\
+    _(memory_lock,                "meml",  "ml",  "lock memory above cursor")\
+    _(memory_unlock,              "memu",  "mu",  "unlock memory")\
+    _(box_chars_1,                "box1",  "bx",  "box characters primary set")\
+
+// All the strings are packed into one pool, addressed by 16 bit offsets
+#define CAP_POOL_MEMBERS(l,sn,tc,d)	char l##_n [sizeof(#l)], l##_sn [sizeof(sn)], l##_tc [sizeof(tc)], l##_d [sizeof(d)];
+#define CAP_POOL_STRINGS(l,sn,tc,d)	#l, sn, tc, d,
+static const struct SCapPool {
+    BOOLEAN_CAPS (CAP_POOL_MEMBERS)
+    NUMBER_CAPS (CAP_POOL_MEMBERS)
+    STRING_CAPS (CAP_POOL_MEMBERS)
+} c_CapPool = {
+    BOOLEAN_CAPS (CAP_POOL_STRINGS)
+    NUMBER_CAPS (CAP_POOL_STRINGS)
+    STRING_CAPS (CAP_POOL_STRINGS)
+};
+_Static_assert (sizeof(c_CapPool) <= UINT16_MAX, "capability strings must be addressable by 16 bit offsets");
+
+#define CAP_COUNT(l,sn,tc,d)	+1
+_Static_assert (0 BOOLEAN_CAPS(CAP_COUNT) == NBooleans, "BOOLEAN_CAPS does not match NBooleans");
+_Static_assert (0 NUMBER_CAPS(CAP_COUNT) == NNumbers, "NUMBER_CAPS does not match NNumbers");
+_Static_assert (0 STRING_CAPS(CAP_COUNT) == NStrings, "STRING_CAPS does not match NStrings");
+
+#define CAP_NAME(l,sn,tc,d)		offsetof (struct SCapPool, l##_n),
+#define CAP_SHORT_NAME(l,sn,tc,d)	offsetof (struct SCapPool, l##_sn),
+#define CAP_TERMCAP(l,sn,tc,d)		offsetof (struct SCapPool, l##_tc),
+#define CAP_DESCRIPTION(l,sn,tc,d)	offsetof (struct SCapPool, l##_d),
+#define ALL_CAPS(f)	{ BOOLEAN_CAPS(f) NUMBER_CAPS(f) STRING_CAPS(f) }
+
+/// Pool offsets of the strings of each standard value row. The type of
+/// the value is not stored; it follows from the row, as in GetRowValue.
+static const struct {
+    uint16_t	name [NValues];
+    uint16_t	shortName [NValues];
+    uint16_t	termcap [NValues];
+    uint16_t	description [NValues];
+} c_Caps = {
+    ALL_CAPS (CAP_NAME),
+    ALL_CAPS (CAP_SHORT_NAME),
+    ALL_CAPS (CAP_TERMCAP),
+    ALL_CAPS (CAP_DESCRIPTION)
+};
 
-static const char* GetBooleanName (unsigned i)
-    { return GetStrtableEntry (i, NBooleans, c_BooleanNames, sizeof(c_BooleanNames)); }
-static const char* GetNumberName (unsigned i)
-    { return GetStrtableEntry (i, NNumbers, c_NumberNames, sizeof(c_NumberNames)); }
-static const char* GetStringName (unsigned i)
-    { return GetStrtableEntry (i, NStrings, c_StringNames, sizeof(c_StringNames)); }
+static const char* CapPoolString (unsigned o)
+    { return (const char*) &c_CapPool + o; }
+static const char* ValueName (unsigned r)
+    { return CapPoolString (c_Caps.name[r]); }
+static const char* ValueShortName (unsigned r)
+    { return CapPoolString (c_Caps.shortName[r]); }
+static const char* ValueTermcap (unsigned r)
+    { return CapPoolString (c_Caps.termcap[r]); }
+static const char* ValueDescription (unsigned r)
+    { return CapPoolString (c_Caps.description[r]); }
 
 //}}}-------------------------------------------------------------------